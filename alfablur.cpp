@@ -33,6 +33,55 @@
 #include <assert.h>
 #include "demo.h"
 
+namespace {
+    // The blur filters process a block of BLOCKSIZE adjacent columns
+    // (or rows) of the image in parallel. The 1-D images passed to
+    // the filters are interleaved so that each element of the image
+    // is a group of BLOCKSIZE values, one from each column (or row).
+    // Stepping through a block of columns one row at a time keeps
+    // memory accesses to the image sequential, and the innermost
+    // loops over the BLOCKSIZE values are readily vectorized.
+    const int BLOCKSIZE = 8;
+
+    //-------------------------------------------------------------------
+    //
+    // Convolves an interleaved 1-D source image 'src' with a box
+    // filter of radius 'r' (and width 2*r+1), and writes the result to
+    // interleaved destination image 'dst'. The 'src' array contains
+    // 'len' groups of BLOCKSIZE values, and the 'dst' array contains
+    // len+2*r groups. The groups outside the 'src' array are treated
+    // as zeros. A running sum is used, so the cost per pixel is
+    // independent of the filter radius.
+    //
+    //-------------------------------------------------------------------
+
+    void BoxFilter(COLOR dst[], const COLOR src[], int len, int r)
+    {
+        int w = 2*r + 1;
+        COLOR sum[BLOCKSIZE];
+
+        memset(&sum[0], 0, sizeof(sum));
+        for (int i = 0; i < len + 2*r; ++i)
+        {
+            if (i < len)
+            {
+                const COLOR *pin = &src[i*BLOCKSIZE];
+                for (int k = 0; k < BLOCKSIZE; ++k)
+                    sum[k] += pin[k];
+            }
+            if (i >= w)
+            {
+                const COLOR *pout = &src[(i - w)*BLOCKSIZE];
+                for (int k = 0; k < BLOCKSIZE; ++k)
+                    sum[k] -= pout[k];
+            }
+            COLOR *pdst = &dst[i*BLOCKSIZE];
+            for (int k = 0; k < BLOCKSIZE; ++k)
+                pdst[k] = (sum[k] + w/2)/w;
+        }
+    }
+}
+
 //---------------------------------------------------------------------
 //
 // An AlphaBlur object uses a Gaussian filter to blur images, and can
@@ -49,10 +98,13 @@
 
 // Public constructor
 AlphaBlur::AlphaBlur(const PIXEL_BUFFER *srcimage,
-                     int kwidth, float stddev, COLOR color) :
-             _kwidth(0), _stddev(0), _numpixels(0), _index(0)
+                     int kwidth, float stddev, COLOR color, int maxrad) :
+             _kwidth(0), _stddev(0), _kcoeff(0), _maxrad(maxrad),
+             _numpixels(0), _index(0)
 {
     memset(&_blurbuf, 0, sizeof(_blurbuf));
+    memset(&_boxrad[0], 0, sizeof(_boxrad));
+    _boxbuf[0] = _boxbuf[1] = 0;
     if (CreateFilterKernel(kwidth, stddev) == false)
     {
         assert(_kwidth > 0);
@@ -131,7 +183,10 @@ bool AlphaBlur::GetBlurredBoundingBox(SGRect *blurbbox, const SGRect *bbox)
 // and stored in the kcoeff array. Note that this array's length is
 // 1+kwidth/2, not kwidth! The coefficients are stored as 16-bit
 // integer alpha values in the range 0 to 1.0, where 1.0 is
-// represented as 0x0000ffff. Returns true if successful.
+// represented as 0x0000ffff. If the kernel radius is larger than the
+// _maxrad value, this function also selects the radii for the three
+// box filters that approximate the Gaussian kernel. Returns true if
+// successful.
 //
 bool AlphaBlur::CreateFilterKernel(int kwidth, float stddev)
 {
@@ -173,6 +228,27 @@ bool AlphaBlur::CreateFilterKernel(int kwidth, float stddev)
     for (int i = 0; i <= rad; ++i)
         _kcoeff[i] = norm*ktemp[i];  // normalize
 
+    if (rad > _maxrad)
+    {
+        // Approximate the Gaussian kernel with three box filters. The
+        // variance of a box filter of radius r is r*(r+1)/3, and the
+        // variances of successive filters add. The box radii are
+        // chosen to match the variance of the (truncated) Gaussian
+        // kernel, per the method described by Peter Kovesi in "Fast
+        // Almost-Gaussian Filtering" (2010).
+        float var = 0;
+        for (int i = 1; i <= rad; ++i)
+            var += 2*i*i*ktemp[i];
+
+        var /= sum;
+        int wl = sqrt(4*var + 1);  // ideal box width, rounded down
+        wl -= (~wl & 1);           // box width must be odd integer
+        int m = (12*var - 3*wl*wl - 12*wl - 9)/(-4*wl - 4) + 0.5f;
+        m = max(0, min(m, 3));
+        for (int i = 0; i < 3; ++i)
+            _boxrad[i] = (i < m) ? wl/2 : wl/2 + 1;
+    }
+
     _stddev = stddev;
     _kwidth = kwidth;
     delete[] ktemp;
@@ -181,44 +257,105 @@ bool AlphaBlur::CreateFilterKernel(int kwidth, float stddev)
 
 // Private function: Convolves a 1-D source image 'src' with a
 // Gaussian filter kernel of width 'kwidth', and writes the result to
-// destination image 'dst'. The 'src' array is of length 'len', and
-// the 'dst' array has length len+2*rad, where rad = floor(kwidth/2).
-// Kernel width 'kwidth' is always odd. This function assumes that
-// the caller previously set the 2*rad pixels on either side of the
-// 'len' pixels in the 'src' array to zero.
+// destination image 'dst'. Both images are interleaved, so that each
+// element is a group of BLOCKSIZE values from adjacent columns (or
+// rows), and all the values in a group are filtered in parallel. The
+// 'src' array contains 'len' groups, and the 'dst' array contains
+// len+2*rad groups, where rad = floor(kwidth/2). Kernel width
+// 'kwidth' is always odd. This function assumes that the caller
+// previously set the 2*rad groups on either side of the 'len' groups
+// in the 'src' array to zero.
 //
 void AlphaBlur::ApplyGaussianFilter(COLOR dst[], const COLOR src[], int len)
 {
     int rad = _kwidth/2;
-    const COLOR *psrc = &src[-rad], *pR, *pL;
-    COLOR *pdst = &dst[0], *pK, sum;
+    const COLOR *psrc = &src[-rad*BLOCKSIZE];
+    COLOR *pdst = &dst[0];
 
-    len += _kwidth;
+    len += 2*rad;
     for (int i = 0; i < len; ++i)
     {
-        pR = pL = psrc++;
-        pK = &_kcoeff[0];
-        sum = (pK[0]*pR[0]) >> 16;
-        for (int j = 0; j < rad; ++j)
-            sum += (*++pK * (*++pR + *--pL)) >> 16;
+        COLOR sum[BLOCKSIZE];
+        COLOR k0 = _kcoeff[0];
+
+        for (int k = 0; k < BLOCKSIZE; ++k)
+            sum[k] = (k0*psrc[k]) >> 16;
+
+        for (int j = 1; j <= rad; ++j)
+        {
+            const COLOR *pR = &psrc[j*BLOCKSIZE];
+            const COLOR *pL = &psrc[-j*BLOCKSIZE];
+            COLOR kj = _kcoeff[j];
+
+            for (int k = 0; k < BLOCKSIZE; ++k)
+                sum[k] += (kj*(pR[k] + pL[k])) >> 16;
+        }
+        for (int k = 0; k < BLOCKSIZE; ++k)
+            pdst[k] = sum[k];
+
+        psrc += BLOCKSIZE;
+        pdst += BLOCKSIZE;
+    }
+}
+
+// Private function: Approximates the Gaussian filter by convolving
+// the 1-D source image 'src' with three box filters in succession.
+// The parameters and their requirements are the same as for the
+// ApplyGaussianFilter function. The combined support of the three box
+// filters can differ from the kernel width, in which case the result
+// is centered on the 'dst' array and any excess is discarded.
+//
+void AlphaBlur::ApplyBoxFilters(COLOR dst[], const COLOR src[], int len)
+{
+    int rad = _kwidth/2;
+    int r0 = _boxrad[0], r1 = _boxrad[1], r2 = _boxrad[2];
+    int r = r0 + r1 + r2;
+    COLOR *tmp0 = _boxbuf[0], *tmp1 = _boxbuf[1];
+
+    BoxFilter(tmp0, src, len, r0);
+    BoxFilter(tmp1, tmp0, len + 2*r0, r1);
+    BoxFilter(tmp0, tmp1, len + 2*(r0 + r1), r2);
+    for (int i = 0; i < len + 2*rad; ++i)
+    {
+        int j = i + r - rad;
+        COLOR *pdst = &dst[i*BLOCKSIZE];
 
-        *pdst++ = sum;
+        if (0 <= j && j < len + 2*r)
+            memcpy(pdst, &tmp0[j*BLOCKSIZE], BLOCKSIZE*sizeof(COLOR));
+        else
+            memset(pdst, 0, BLOCKSIZE*sizeof(COLOR));
     }
 }
 
-// Private function: Uses a Gaussian filter to blur the 32-bpp input
-// image in the pixel buffer specified by input parameter 'srcimage'.
+// Private function: Applies the 1-D blur filter -- either the Gaussian
+// filter or its box-filter approximation -- to source image 'src'
+//
+void AlphaBlur::ApplyFilter(COLOR dst[], const COLOR src[], int len)
+{
+    if (_boxbuf[0] != 0)
+        ApplyBoxFilters(dst, src, len);
+    else
+        ApplyGaussianFilter(dst, src, len);
+}
+
+// Private function: Uses a Gaussian filter to blur the input image in
+// the pixel buffer specified by input parameter 'srcimage'. The input
+// image contains either 32-bit pixels or 8-bit alpha values (for
+// example, a mask rendered by a CreateAlphaRenderer renderer).
 // The function allocates an output buffer and writes the blurred
 // image to this buffer. Blurring will expand the rectangular image
 // by rad = 2*floor(kwidth/2) pixels on each of its four sides. Only
 // the alpha channel in the source image is filtered; the source RGB
 // values are ignored, and the specified fill color (in the '_color'
 // member) is used instead to color the resulting blurred image.
+// Both the vertical and horizontal filtering passes process the
+// image in blocks of BLOCKSIZE columns or rows at a time.
 //
 bool AlphaBlur::BlurImage(const PIXEL_BUFFER *srcimage)
 {
     if (srcimage->pixels == 0 || srcimage->width < 1 || srcimage->height < 1 ||
-        srcimage->pitch < srcimage->width || srcimage->depth != 32)
+        (srcimage->depth != 32 && srcimage->depth != 8) ||
+        srcimage->pitch < srcimage->width*(srcimage->depth/8))
     {
         assert(0);
         return false;  // fail - invalid input image descriptor
@@ -229,7 +366,7 @@ bool AlphaBlur::BlurImage(const PIXEL_BUFFER *srcimage)
     _blurbuf.width = srcimage->width + 2*rad;
     _blurbuf.height = srcimage->height + 2*rad;
     _blurbuf.pitch = _blurbuf.width*sizeof(COLOR);
-    _blurbuf.depth = srcimage->depth;
+    _blurbuf.depth = 32;
     _numpixels = _blurbuf.width*_blurbuf.height;
     _blurbuf.pixels = new COLOR[_numpixels];
     if (_blurbuf.pixels == 0)
@@ -238,125 +375,182 @@ bool AlphaBlur::BlurImage(const PIXEL_BUFFER *srcimage)
         _numpixels = _blurbuf.width = _blurbuf.height = 0;
         return false;  // fail - out of memory
     }
-    COLOR *pincol = &srcimage->pixels[0];
-    COLOR *poutcol = &_blurbuf.pixels[rad];
-    int instride = srcimage->pitch/sizeof(srcimage->pixels[0]);
-    int outstride = _blurbuf.width;
 
-    // Allocate scratch buffer to filter columns from input image.
-    int scratchwidth = srcimage->height + 4*rad;
-    COLOR *scratch = AllocateRawPixels(scratchwidth, 2, RGBA(0,0,0,0));
+    // Allocate the scratch buffers for filtering blocks of columns
+    // or rows. The source buffer has margins of 2*rad groups (set to
+    // zero) on either side of the copied pixels so we don't have to
+    // deal with boundary conditions. If the Gaussian is to be
+    // approximated by box filters, also allocate the scratch buffers
+    // for the intermediate filter results.
+    int maxlen = max(srcimage->width, srcimage->height);
+    COLOR *blksrc = new COLOR[(maxlen + 4*rad)*BLOCKSIZE];
+    COLOR *blkdst = new COLOR[(maxlen + 2*rad)*BLOCKSIZE];
+    if (blksrc == 0 || blkdst == 0)
+    {
+        assert(blksrc != 0 && blkdst != 0);
+        delete[] blksrc;
+        delete[] blkdst;
+        return false;  // fail - out of memory
+    }
+    memset(blksrc, 0, (maxlen + 4*rad)*BLOCKSIZE*sizeof(COLOR));
+    if (rad > _maxrad)
+    {
+        int len = maxlen + 2*(_boxrad[0] + _boxrad[1] + _boxrad[2]);
+        _boxbuf[0] = new COLOR[2*len*BLOCKSIZE];
+        if (_boxbuf[0] == 0)
+        {
+            assert(_boxbuf[0]);
+            delete[] blksrc;
+            delete[] blkdst;
+            return false;  // fail - out of memory
+        }
+        _boxbuf[1] = &_boxbuf[0][len*BLOCKSIZE];
+    }
+    int outstride = _blurbuf.width;
 
     // First, process the image in the vertical direction by
     // convolving each column with a 1-D filter. Blurring will
     // increase the height of each column by 2*rad pixels. Each
-    // for-loop iteration below vertically filters one column
-    // of pixels.
-    for (int i = 0; i < srcimage->width; ++i)
+    // for-loop iteration below vertically filters one block of
+    // up to BLOCKSIZE adjacent columns.
+    for (int i = 0; i < srcimage->width; i += BLOCKSIZE)
     {
-        // Copy the next column of pixels from the input image to
-        // the first row of the scratch buffer. Leave margins of
-        // 2*rad pixels (set to zero) on either side of the copied
-        // pixels so we don't have to deal with boundary conditions.
-        // Only the alpha fields of the copied pixels are preserved.
-        // To improve filtering precision, each 8-bit alpha value is
-        // converted to a 16-bit alpha value.
-        COLOR *pin = pincol++;
-        COLOR *pdst = &scratch[2*rad];
+        int ncols = min(BLOCKSIZE, srcimage->width - i);
+
+        // Copy the next block of columns from the input image to the
+        // source buffer, one row at a time. Only the alpha fields of
+        // the copied pixels are preserved. To improve filtering
+        // precision, each 8-bit alpha value is converted to a 16-bit
+        // alpha value. Unused values in a partial block are zeros.
+        const char *prow = (const char*)srcimage->pixels;
+        COLOR *pdst = &blksrc[2*rad*BLOCKSIZE];
         for (int j = 0; j < srcimage->height; ++j)
         {
-            COLOR alpha = *pin >> 24;
-            *pdst++ = alpha | (alpha << 8);
-            pin = &pin[instride];
+            if (srcimage->depth == 8)
+            {
+                const unsigned char *pin = (const unsigned char*)prow + i;
+                for (int k = 0; k < ncols; ++k)
+                {
+                    COLOR alpha = pin[k];
+                    pdst[k] = alpha | (alpha << 8);
+                }
+            }
+            else
+            {
+                const COLOR *pin = (const COLOR*)prow + i;
+                for (int k = 0; k < ncols; ++k)
+                {
+                    COLOR alpha = pin[k] >> 24;
+                    pdst[k] = alpha | (alpha << 8);
+                }
+            }
+            for (int k = ncols; k < BLOCKSIZE; ++k)
+                pdst[k] = 0;
+
+            prow = &prow[srcimage->pitch];
+            pdst = &pdst[BLOCKSIZE];
         }
 
-        // Convolve the input pixels in the scratch buffer's first
-        // row with the 1-D Gaussian filter. Write the blurred result
-        // to the second row of the scratch buffer.
-        COLOR *psrc = &scratch[2*rad];
-        pdst = &scratch[rad + scratchwidth];
-        ApplyGaussianFilter(pdst, psrc, srcimage->height);
-        psrc = pdst;
-
-        // Copy the blurred pixels from the second row of the scratch
-        // buffer to the next column of the blurred image buffer
-        COLOR *pout = poutcol++;
+        // Convolve the block of columns with the 1-D Gaussian filter
+        ApplyFilter(blkdst, &blksrc[2*rad*BLOCKSIZE], srcimage->height);
+
+        // Copy the blurred block of columns to the blurred image buffer
+        COLOR *psrc = &blkdst[0];
+        COLOR *pout = &_blurbuf.pixels[rad + i];
         for (int j = 0; j < _blurbuf.height; ++j)
-            *pout = *psrc++, pout = &pout[outstride];
+        {
+            memcpy(pout, psrc, ncols*sizeof(COLOR));
+            psrc = &psrc[BLOCKSIZE];
+            pout = &pout[outstride];
+        }
     }
-    DeleteRawPixels(scratch);
 
     // So far, vertical filtering has increased the height of the
     // image by 2*rad. Next, this intermediate image will be filtered
     // horizontally, which will increase the image width by 2*rad.
-    COLOR *pinrow = &_blurbuf.pixels[rad];
-    COLOR *poutrow = &_blurbuf.pixels[0];
-
-    // Allocate scratch buffer to filter rows from intermediate image
-    scratchwidth = srcimage->width + 4*rad;
-    scratch = AllocateRawPixels(scratchwidth, 2, RGBA(0,0,0,0));
-
-    // To construct the final output image, each for-loop iteration
-    // below horizontally filters one row from the intermediate image
-    for (int j = 0; j < _blurbuf.height; ++j)
+    // Each for-loop iteration below horizontally filters one block
+    // of up to BLOCKSIZE adjacent rows from the intermediate image.
+    // The vertical pass might have left pixels in the source buffer
+    // that now fall in the right margin, so clear them first.
+    int endlen = 2*rad + srcimage->width;
+    memset(&blksrc[endlen*BLOCKSIZE], 0,
+           (maxlen + 4*rad - endlen)*BLOCKSIZE*sizeof(COLOR));
+    for (int j = 0; j < _blurbuf.height; j += BLOCKSIZE)
     {
-        // Copy the next row of pixels from the intermediate image
-        // to the first row of the scratch buffer, and leave
-        // margins of 2*rad pixels (set to zero) on either side.
-        COLOR *pin = pinrow;
-        COLOR *pdst = &scratch[2*rad];
-        pinrow = &pinrow[outstride];
-        for (int i = 0; i < srcimage->width; ++i)
-            *pdst++ = *pin++;
-
-        // Convolve input pixels with Gaussian filter. The blurred
-        // result resides in the second row of the scratch buffer.
-        COLOR *psrc = &scratch[2*rad];
-        pdst = &scratch[rad + scratchwidth];
-        ApplyGaussianFilter(pdst, psrc, srcimage->width);
-        psrc = pdst;
-
-        // Combine the 16-bit alpha values from the current row of the
-        // blurred image with the 8-bit alpha field in the fill color
-        COLOR *pout = poutrow;
-        poutrow = &poutrow[outstride];
-        if (_alpha == 255)
+        int nrows = min(BLOCKSIZE, _blurbuf.height - j);
+
+        // Copy the next block of rows from the intermediate image to
+        // the source buffer, and leave margins (set to zero) on
+        // either side.
+        COLOR *pinrow = &_blurbuf.pixels[j*outstride + rad];
+        for (int k = 0; k < BLOCKSIZE; ++k)
         {
-            // The fill color is fully opaque, so just truncate the
-            // 16-bit alpha to 8 bits and plug it into the fill color
-            for (int i = 0; i < _blurbuf.width; ++i)
+            COLOR *pdst = &blksrc[2*rad*BLOCKSIZE + k];
+
+            if (k < nrows)
+            {
+                COLOR *pin = &pinrow[k*outstride];
+                for (int i = 0; i < srcimage->width; ++i)
+                    pdst[i*BLOCKSIZE] = pin[i];
+            }
+            else
             {
-                COLOR ablur = *psrc++ >> 8;
-                *pout++ = (ablur << 24) | _rgb;
+                for (int i = 0; i < srcimage->width; ++i)
+                    pdst[i*BLOCKSIZE] = 0;
             }
         }
-        else
+
+        // Convolve the block of rows with the 1-D Gaussian filter
+        ApplyFilter(blkdst, &blksrc[2*rad*BLOCKSIZE], srcimage->width);
+
+        // Combine the 16-bit alpha values from each row in the block
+        // of blurred rows with the 8-bit alpha field in the fill color
+        for (int k = 0; k < nrows; ++k)
         {
-            for (int i = 0; i < _blurbuf.width; ++i)
+            COLOR *psrc = &blkdst[k];
+            COLOR *pout = &_blurbuf.pixels[(j + k)*outstride];
+
+            if (_alpha == 255)
             {
-                COLOR ablur16 = *psrc++;
-                COLOR ablur8 = ablur16 >> 8;
-                if (ablur8 == 0)
+                // The fill color is fully opaque, so just truncate the
+                // 16-bit alpha to 8 bits and plug it into the fill color
+                for (int i = 0; i < _blurbuf.width; ++i)
                 {
-                    *pout++ = 0;
+                    COLOR ablur = psrc[i*BLOCKSIZE] >> 8;
+                    *pout++ = (ablur << 24) | _rgb;
                 }
-                else if (ablur8 == 255)
-                {
-                    *pout++ = _rgba;
-                }
-                else
+            }
+            else
+            {
+                for (int i = 0; i < _blurbuf.width; ++i)
                 {
-                    // Multiply the 8-bit alpha from the fill color
-                    // by the 16-bit alpha from the blurred image
-                    int alpha = _alpha*ablur16;
-                    alpha += 0x00008000;
-                    alpha >>= 16;
-                    *pout++ = (alpha << 24) | _rgb;
+                    COLOR ablur16 = psrc[i*BLOCKSIZE];
+                    COLOR ablur8 = ablur16 >> 8;
+                    if (ablur8 == 0)
+                    {
+                        *pout++ = 0;
+                    }
+                    else if (ablur8 == 255)
+                    {
+                        *pout++ = _rgba;
+                    }
+                    else
+                    {
+                        // Multiply the 8-bit alpha from the fill color
+                        // by the 16-bit alpha from the blurred image
+                        int alpha = _alpha*ablur16;
+                        alpha += 0x00008000;
+                        alpha >>= 16;
+                        *pout++ = (alpha << 24) | _rgb;
+                    }
                 }
             }
         }
     }
-    DeleteRawPixels(scratch);
+    delete[] blksrc;
+    delete[] blkdst;
+    delete[] _boxbuf[0];
+    _boxbuf[0] = _boxbuf[1] = 0;
     return true;
 }
 
@@ -118,24 +118,41 @@ namespace {
 // conjugate diameter end points (xP,yP) and (xQ,yQ). The
 // corresponding angular increment is alpha = 1/2^k radians, and
 // multiplication of a value x by alpha is calculated as x >> k.
+// A path often contains many copies of the same small ellipse (for
+// example, the dots in a line of text), so the result of the last
+// call is saved and is reused if the next call specifies the same
+// conjugate diameters at the same flatness.
 //
 //-------------------------------------------------------------------
 
 int PathMgr::AngularInc(FIX16 xP, FIX16 yP, FIX16 xQ, FIX16 yQ)
 {
+    if (_flatness == _arcflat && xP == _arcvec[0].x && yP == _arcvec[0].y &&
+        xQ == _arcvec[1].x && yQ == _arcvec[1].y)
+    {
+        return _arcinc;
+    }
+
     FIX16 r = AuxRadius(xP, yP, xQ, yQ);
     FIX16 err2 = r >> 3;    // 2nd-order term
     FIX16 err4 = r >> 7;    // 4th-order term
+    int k;
 
-    for (int k = 0; k < KMAX; ++k)
+    for (k = 0; k < KMAX; ++k)
     {
         if (_flatness >= err2 + err4)
-            return k;
+            break;
 
         err2 >>= 2;
         err4 >>= 4;
     }
-    return KMAX;
+    _arcvec[0].x = xP;
+    _arcvec[0].y = yP;
+    _arcvec[1].x = xQ;
+    _arcvec[1].y = yQ;
+    _arcflat = _flatness;
+    _arcinc = k;
+    return k;
 }
 
 //---------------------------------------------------------------------
@@ -150,13 +167,30 @@ int PathMgr::AngularInc(FIX16 xP, FIX16 yP, FIX16 xQ, FIX16 yQ)
 // is the angle swept out by the arc. If parameter asweep is positive,
 // the arc sweeps in the direction from (xP,yP) to (xQ,yQ). This code
 // is based on the quarter-ellipse algorithm from Graphics Gems III.
+// Parameter k is the exponent of the angular increment between points
+// (see AngularInc). If k is negative, it's calculated from P and Q.
+// If the entire ellipse lies outside the curve culling rectangle, no
+// points are generated, so that the arc is replaced by its chord.
 //
 //----------------------------------------------------------------------
 
 void PathMgr::EllipseCore(FIX16 xC, FIX16 yC, FIX16 xP, FIX16 yP,
-                          FIX16 xQ, FIX16 yQ, FIX16 sweep)
+                          FIX16 xQ, FIX16 yQ, FIX16 sweep, int k)
 {
-    int k = AngularInc(xP, yP, xQ, yQ);
+    if (_cullmargin >= 0)
+    {
+        // Each point on the ellipse is C + P*cos(t) + Q*sin(t)
+        FIX16 dx = abs(xP) + abs(xQ);
+        FIX16 dy = abs(yP) + abs(yQ);
+        VERT16 bbox[2] = { { xC - dx, yC - dy }, { xC + dx, yC + dy } };
+
+        if (IsCulled(bbox, 2))
+            return;
+    }
+
+    if (k < 0)
+        k = AngularInc(xP, yP, xQ, yQ);
+
     int count = sweep >> (16 - k);
 
     xQ = InitialValue(xQ, xP, k);
@@ -188,17 +222,24 @@ void PathMgr::EllipseCore(FIX16 xC, FIX16 yC, FIX16 xP, FIX16 yP,
 
 void PathMgr::Ellipse(const SGPoint& v0, const SGPoint& v1, const SGPoint& v2)
 {
-    FIX16 xC = v0.x << _fixshift;
-    FIX16 yC = v0.y << _fixshift;
-    FIX16 xP = (v1.x - v0.x) << _fixshift;
-    FIX16 yP = (v1.y - v0.y) << _fixshift;
-    FIX16 xQ = (v2.x - v0.x) << _fixshift;
-    FIX16 yQ = (v2.y - v0.y) << _fixshift;
+    VERT16 c, p, q;
+
+    // An affine transform maps conjugate diameters to conjugate
+    // diameters, so we can transform the three points directly
+    UserToDevice(&c, v0.x, v0.y);
+    UserToDevice(&p, v1.x, v1.y);
+    UserToDevice(&q, v2.x, v2.y);
+
+    FIX16 xC = c.x;
+    FIX16 yC = c.y;
+    FIX16 xP = p.x - c.x;
+    FIX16 yP = p.y - c.y;
+    FIX16 xQ = q.x - c.x;
+    FIX16 yQ = q.y - c.y;
 
     EndFigure();
     _cpoint = _fpoint;
-    _cpoint->x = v1.x << _fixshift;
-    _cpoint->y = v1.y << _fixshift;
+    *_cpoint = p;
     EllipseCore(xC, yC, xP, yP, xQ, yQ, FIX_2PI);
     CloseFigure();
 }
@@ -225,12 +266,18 @@ void PathMgr::Ellipse(const SGPoint& v0, const SGPoint& v1, const SGPoint& v2)
 void PathMgr::EllipticArc(const SGPoint& v0, const SGPoint& v1, const SGPoint& v2,
                           float astart, float asweep)
 {
-    FIX16 xC = v0.x << _fixshift;
-    FIX16 yC = v0.y << _fixshift;
-    FIX16 xP = (v1.x - v0.x) << _fixshift;
-    FIX16 yP = (v1.y - v0.y) << _fixshift;
-    FIX16 xQ = (v2.x - v0.x) << _fixshift;
-    FIX16 yQ = (v2.y - v0.y) << _fixshift;
+    VERT16 c, p, q;
+
+    UserToDevice(&c, v0.x, v0.y);
+    UserToDevice(&p, v1.x, v1.y);
+    UserToDevice(&q, v2.x, v2.y);
+
+    FIX16 xC = c.x;
+    FIX16 yC = c.y;
+    FIX16 xP = p.x - c.x;
+    FIX16 yP = p.y - c.y;
+    FIX16 xQ = q.x - c.x;
+    FIX16 yQ = q.y - c.y;
     float cosb, sinb;
     FIX16 swangle;
 
@@ -292,24 +339,42 @@ void PathMgr::EllipticArc(const SGPoint& v0, const SGPoint& v1, const SGPoint& v
 
 bool PathMgr::EllipticSpline(const SGPoint& v1, const SGPoint& v2)
 {
+    VERT16 v[2];
+
     if (_cpoint == 0)
     {
         assert(_cpoint != 0);
         return false;
     }
+    UserToDevice(&v[0], v1.x, v1.y);
+    UserToDevice(&v[1], v2.x, v2.y);
+    EllipticSplineCore(v[0], v[1]);
+    return true;
+}
 
+//----------------------------------------------------------------------
+//
+// Private function: Appends an elliptic spline to the current figure.
+// Does the work for the EllipticSpline and PolyEllipticSpline
+// functions. Parameters v1 and v2 are the spline's control point and
+// end point, which have already been converted to transformed 16.16
+// fixed-point coordinates.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::EllipticSplineCore(const VERT16& v1, const VERT16& v2)
+{
     FIX16 xP = _cpoint->x;
     FIX16 yP = _cpoint->y;
-    FIX16 xQ = v2.x << _fixshift;
-    FIX16 yQ = v2.y << _fixshift;
-    FIX16 xC = xP + xQ - (v1.x << _fixshift);
-    FIX16 yC = yP + yQ - (v1.y << _fixshift);
+    FIX16 xQ = v2.x;
+    FIX16 yQ = v2.y;
+    FIX16 xC = xP + xQ - v1.x;
+    FIX16 yC = yP + yQ - v1.y;
 
     EllipseCore(xC, yC, xP-xC, yP-yC, xQ-xC, yQ-yC, FIX_PI/2);
     PathCheck(++_cpoint);
     _cpoint->x = xQ;
     _cpoint->y = yQ;
-    return true;
 }
 
 //----------------------------------------------------------------------
@@ -328,17 +393,24 @@ bool PathMgr::EllipticSpline(const SGPoint& v1, const SGPoint& v2)
 
 bool PathMgr::PolyEllipticSpline(const SGPoint xy[], int npts)
 {
-    const SGPoint *pxy = &xy[0];
+    const int BATCHLEN = 2*32;
+    VERT16 v[BATCHLEN];
 
     if (_cpoint == 0 || npts < 0 || xy == 0)
     {
         assert(_cpoint != 0 && npts >= 0 && xy != 0);
         return false;
     }
-    for (int i = 0; i < npts; i += 2)
+
+    // Convert the points in batches, and then draw the splines
+    npts -= npts % 2;
+    for (int i = 0; i < npts; i += BATCHLEN)
     {
-        EllipticSpline(pxy[0], pxy[1]);
-        pxy = &pxy[2];
+        int count = min(npts - i, BATCHLEN);
+
+        UserToDevice(v, &xy[i], count);
+        for (int j = 0; j < count; j += 2)
+            EllipticSplineCore(v[j], v[j+1]);
     }
     return true;
 }
@@ -364,6 +436,32 @@ void PathMgr::RoundedRectangle(const SGRect& rect, const SGPoint& round)
         Rectangle(rect);
         return;
     }
+    if (_bXform)
+    {
+        // The transformed rectangle might not be axis-aligned, so
+        // draw each rounded corner as an elliptic spline instead of
+        // using symmetry to copy one corner to the other three
+        SGCoord xmin = rect.x, ymin = rect.y;
+        SGCoord xmax = rect.x + rect.w, ymax = rect.y + rect.h;
+        SGPoint xy[] = {
+            { xmin, ymin }, { xmin + round.x, ymin },
+            { xmax - round.x, ymin },  // line
+            { xmax, ymin }, { xmax, ymin + round.y },
+            { xmax, ymax - round.y },  // line
+            { xmax, ymax }, { xmax - round.x, ymax },
+            { xmin + round.x, ymax },  // line
+            { xmin, ymax }, { xmin, ymax - round.y },
+        };
+        Move(xmin, ymin + round.y);
+        for (int i = 0; i < 4; ++i)
+        {
+            EllipticSpline(xy[3*i], xy[3*i+1]);
+            if (i < 3)
+                Line(xy[3*i+2].x, xy[3*i+2].y);
+        }
+        CloseFigure();
+        return;
+    }
 
     // Convert input parameters to internal fixed-point format
     FIX16 xmin = rect.x << _fixshift;
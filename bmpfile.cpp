@@ -34,6 +34,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "demo.h"
 
 //---------------------------------------------------------------------
@@ -160,8 +162,9 @@ namespace {
 
 // Public constructor: Opens the caller-specified BMP file
 BmpReader::BmpReader(const char *pszFile) :
-               _width(0), _height(0), _bpp(0), _flags(0), _offset(0),
-               _pad(0), _bAlpha(false), _row(0), _col(0)
+               _flags(0), _offset(0), _width(0), _height(0), _bpp(0),
+               _bAlpha(false), _row(0), _col(0), _pad(0), _mtime(0),
+               _fsize(0), _rowbuf(0)
 {
     const int MAX_FILENAME_LEN = 255;
     char *pszError = 0;
@@ -282,9 +285,29 @@ BmpReader::BmpReader(const char *pszFile) :
             break;
         }
 
+        // Allocate buffer to hold one row of pixel data from file
+        _rowbuf = new unsigned char[stride];
+        if (_rowbuf == 0)
+        {
+            pszError = "is too large to read (out of memory)";
+            break;
+        }
+
         // Move file position to start of pixel data
         RewindData();
     }
+    // Record the file's name, modification time and size, which
+    // identify the decoded image if the renderer keeps it for reuse
+    struct stat st;
+    _name[0] = '\0';
+    if (pszError == 0 && strlen(pszFile) < sizeof(_name) &&
+        stat(pszFile, &st) == 0)
+    {
+        strcpy(_name, pszFile);
+        _mtime = st.st_mtime;
+        _fsize = st.st_size;
+    }
+
     if (pszError)
     {
         char sbuf[256];
@@ -312,6 +335,27 @@ BmpReader::~BmpReader()
 {
     if (_pFile)
         fclose(_pFile);
+
+    delete[] _rowbuf;
+}
+
+// Public function: Returns the name of the BMP file. The renderer
+// uses the name to identify the decoded image so that it can reuse
+// the image instead of reading the file again. Returns a null
+// pointer if the file couldn't be opened, the name is too long, or
+// the file's time stamp couldn't be read.
+const char* BmpReader::GetImageName()
+{
+    return (_pFile != 0 && _name[0] != '\0') ? _name : 0;
+}
+
+// Public function: Gets the modification time and size of the BMP
+// file. The renderer reuses a decoded image only if these values
+// haven't changed since the image was decoded.
+void BmpReader::GetImageStamp(long *mtime, long *size)
+{
+    *mtime = _mtime;
+    *size = _fsize;
 }
 
 // Private function: Opens message box to notify user of error
@@ -345,82 +389,77 @@ bool BmpReader::GetImageInfo(int *width, int *height, int *flags)
 int BmpReader::ReadPixels(COLOR *buffer, int count)
 {
     int k;
-    COLOR *pOut = 0;
-    COLOR tinybuf = 0;
+    COLOR *pOut = &buffer[0];
 
     if (_pFile == 0)
         return 0;
 
-    if (_bpp == 24)
+    if (_bpp == 32 && _bAlpha)
     {
-        tinybuf = 0xff000000;  // tiny buffer holds 1 pixel
+        // Easy case: 32-bit source pixels have 8-bit alphas
+        assert(_pad == 0);
+        k = fread(&buffer[0], 4, count, _pFile);
+        if (k < count)
+            ErrorMessage("Read request extends past end of .bmp file");
+
+        return k;
+    }
 
-        // Each iteration of this for-loop reads one 24-bit pixel from
-        // the .bmp file, converts it to 32 bits, and writes it to the
-        // buffer
-        pOut = &buffer[0];
-        for (k = 0; k < count; ++k)
+    // Each iteration of this for-loop copies pixels from the current
+    // row of the bitmap, converts them to 32 bits, and writes them
+    // to the buffer. Each row is read from the file all at once.
+    for (k = 0; k < count; )
+    {
+        if (_col >= _width)  // at end of row?
         {
-            if (_col >= _width)  // at end of row?
-            {
-                ++_row;  // yes, start next row
-                if (_row >= _height)  // at end of bitmap?
-                    return k;  // all done
-
-                // Skip past padding at end of row. Padding is never
-                // more than three bytes. Note that we avoid trying
-                // to read any padding past the end of the last row.
-                if (_pad > 0)
-                {
-                    if (fread(&tinybuf, sizeof(char), _pad, _pFile) != _pad)
-                    {
-                        ErrorMessage("Error reading pixel data from .bmp file");
-                        return k;
-                    }
-                }
-                _col = 0;  // start at column zero of new row
-            }
-            if (fread(&tinybuf, 3, 1, _pFile) < 1)
+            if (_row >= _height)  // at end of bitmap?
+                return k;  // all done
+
+            // Read the next row, including the padding at the end of
+            // the row. Padding is never more than three bytes. Note
+            // that we avoid trying to read any padding past the end
+            // of the last row.
+            int nbytes = (_bpp >> 3)*_width;
+            if (_row < _height - 1)
+                nbytes += _pad;
+
+            if (fread(_rowbuf, 1, nbytes, _pFile) != nbytes)
             {
                 ErrorMessage("Read request extends past end of .bmp file");
                 return k;
             }
-            *pOut++ = tinybuf;
-            ++_col;
+            ++_row;
+            _col = 0;  // start at column zero of new row
         }
-        return k;
-    }
-    else if (_bpp == 32)
-    {
-        assert(_pad == 0);
-        if (_bAlpha)
+        int len = min(count - k, _width - _col);
+        if (_bpp == 24)
         {
-            // Easy case: 32-bit source pixels have 8-bit alphas
-            k = fread(&buffer[0], 4, count, _pFile);
-            if (k < count)
-                ErrorMessage("Read request extends past end of .bmp file");
+            const unsigned char *pIn = &_rowbuf[3*_col];
 
-            return k;
-        }
-        pOut = &buffer[0];
-        for (k = 0; k < count; ++k)
-        {
-            if (fread(&tinybuf, 4, 1, _pFile) < 1)
+            for (int i = 0; i < len; ++i)
             {
-                ErrorMessage("Read request extends past end of .bmp file");
-                return k;
+                *pOut++ = 0xff000000 | (pIn[2] << 16) | (pIn[1] << 8) | pIn[0];
+                pIn += 3;
             }
-            *pOut++ = tinybuf | 0xff000000;  // set alpha field to 255
         }
-        return count;
+        else
+        {
+            const COLOR *pIn = reinterpret_cast<COLOR*>(_rowbuf) + _col;
+
+            for (int i = 0; i < len; ++i)
+                *pOut++ = *pIn++ | 0xff000000;  // set alpha field to 255
+        }
+        _col += len;
+        k += len;
     }
-    return 0;
+    return k;
 }
 
 // Public function: Rewinds the .bmp file to the start of the pixel data
 bool BmpReader::RewindData()
 {
-    _row = _col = 0;
+    _row = 0;
+    _col = _width;  // no row has been read yet
     if (fseek(_pFile, _offset, SEEK_SET) != 0)
     {
         ErrorMessage("fseek call failed in RewindData function");
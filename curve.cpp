@@ -47,6 +47,61 @@ namespace {
 
         return y + max(x/8, x/2 - y/8);
     }
+
+    //-------------------------------------------------------------------
+    //
+    // Uses Wang's formula to calculate the number of equal parameter
+    // steps needed to flatten a Bezier curve of degree n to within
+    // tolerance tol. Parameter dmax is the largest second difference,
+    // |v[i] - 2*v[i+1] + v[i+2]|, of the control polygon vertices. The
+    // constant k is n*(n-1)/8. The step count is limited to the number
+    // of segments that subdivision can produce at MAXLEVELS levels.
+    //
+    //-------------------------------------------------------------------
+
+    int WangSteps(FIX16 dmax, float k, FIX16 tol)
+    {
+        const int MAXSTEPS = 1 << MAXLEVELS;
+        float n2 = k*dmax/tol;
+
+        if (n2 <= 1.0f)
+            return 1;
+
+        if (n2 >= float(MAXSTEPS)*MAXSTEPS)
+            return MAXSTEPS;
+
+        return int(ceil(sqrt(n2)));
+    }
+}
+
+//--------------------------------------------------------------------
+//
+// Private function: Returns true if curve culling is enabled and the
+// npts vertices in array v lie entirely outside the curve culling
+// rectangle, on the same side of the rectangle. The curve that the
+// vertices control lies inside their convex hull, so it is off-screen
+// too, and can be replaced by its chord without changing the winding
+// numbers inside the rectangle.
+//
+//--------------------------------------------------------------------
+
+bool PathMgr::IsCulled(const VERT16 v[], int npts)
+{
+    if (_cullmargin < 0)
+        return false;
+
+    FIX16 xmin = v[0].x, ymin = v[0].y;
+    FIX16 xmax = xmin, ymax = ymin;
+
+    for (int i = 1; i < npts; ++i)
+    {
+        xmin = min(xmin, v[i].x);
+        ymin = min(ymin, v[i].y);
+        xmax = max(xmax, v[i].x);
+        ymax = max(ymax, v[i].y);
+    }
+    return (xmax < _cullmin.x || _cullmax.x < xmin ||
+            ymax < _cullmin.y || _cullmax.y < ymin);
 }
 
 //--------------------------------------------------------------------
@@ -82,6 +137,31 @@ bool PathMgr::IsFlatQuadratic(const VERT16 v[3])
 //----------------------------------------------------------------------
 
 bool PathMgr::Bezier2(const SGPoint& v1, const SGPoint& v2)
+{
+    VERT16 v[2];
+
+    if (_cpoint == 0)
+    {
+        assert(_cpoint != 0);
+        return false;
+    }
+    UserToDevice(&v[0], v1.x, v1.y);
+    UserToDevice(&v[1], v2.x, v2.y);
+    Bezier2Core(v[0], v[1]);
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Flattens a quadratic Bezier curve and appends it
+// to the current figure. Does the work for the Bezier2 and PolyBezier2
+// functions. Parameters v1 and v2 are the last two points in the
+// control polygon, which have already been converted to transformed
+// 16.16 fixed-point coordinates.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::Bezier2Core(const VERT16& v1, const VERT16& v2)
 {
     VERT16 vstack[2*MAXLEVELS];  // stack for polygon vertices
     VERT16 *pvstk = &vstack[0];  // vertex stack pointer
@@ -90,24 +170,23 @@ bool PathMgr::Bezier2(const SGPoint& v1, const SGPoint& v2)
     int level = 0;               // current subdivision level
     VERT16 v[2+1][2+1];          // control polygon vertices
 
-    if (_cpoint == 0)
+    if (_flattenmode == FLATTENMODE_UNIFORM)
     {
-        assert(_cpoint != 0);
-        return false;
+        Bezier2Uniform(v1, v2);
+        return;
     }
 
     // Get the three vertices for Bezier control polygon ABC
-    v[0][0] = *_cpoint;             // A
-    v[0][1].x = v1.x << _fixshift;  // B
-    v[0][1].y = v1.y << _fixshift;
-    v[0][2].x = v2.x << _fixshift;  // C
-    v[0][2].y = v2.y << _fixshift;
+    v[0][0] = *_cpoint;  // A
+    v[0][1] = v1;        // B
+    v[0][2] = v2;        // C
 
     // Continue to subdivide Bezier control polygon ABC until the
     // flatness of each curve segment is within the specified tolerance
     for (;;)
     {
-        while (!IsFlatQuadratic(v[0]) && level < MAXLEVELS)
+        while (!IsFlatQuadratic(v[0]) && !IsCulled(v[0], 3) &&
+               level < MAXLEVELS)
         {
             // Subdivide control polygon ABC into ADF and FEC
             for (int j = 1; j <= 2; ++j)
@@ -141,7 +220,57 @@ bool PathMgr::Bezier2(const SGPoint& v1, const SGPoint& v2)
         v[0][1] = *--pvstk;  // B
         v[0][2] = *--pvstk;  // C
     }
-    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Flattens a quadratic Bezier curve into line
+// segments of equal parameter length, and appends the points to the
+// current figure. The control polygon is the current point, v1, and
+// v2. The number of segments is calculated by Wang's formula, and the
+// points are generated by forward differencing. To avoid overflow and
+// to limit the accumulated error, the differences are calculated in
+// floating point, relative to the current point. The last point is
+// always set to exactly v2.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::Bezier2Uniform(const VERT16& v1, const VERT16& v2)
+{
+    VERT16 v0 = *_cpoint;
+    FIX16 ddx = v0.x - 2*v1.x + v2.x;
+    FIX16 ddy = v0.y - 2*v1.y + v2.y;
+    int nsteps = WangSteps(VLen(ddx, ddy), 2.0f/8, _flatness);
+    VERT16 vc[3] = { v0, v1, v2 };
+
+    if (IsCulled(vc, 3))
+        nsteps = 1;  // off-screen curve is replaced by its chord
+
+    // Make room for all the points in the path
+    while (&_cpoint[nsteps] >= &_path[_pathlength])
+        GrowPath();
+
+    // Polynomial coefficients: B(t) = v0 + b*t + a*t^2
+    float h = 1.0f/nsteps;
+    float ax = ddx, ay = ddy;
+    float bx = 2.0f*(v1.x - v0.x), by = 2.0f*(v1.y - v0.y);
+
+    // Forward differences for step size h
+    float fx = 0, fy = 0;
+    float dfx = ax*h*h + bx*h, dfy = ay*h*h + by*h;
+    float ddfx = 2.0f*ax*h*h, ddfy = 2.0f*ay*h*h;
+
+    for (int i = 1; i < nsteps; ++i)
+    {
+        fx += dfx;
+        fy += dfy;
+        dfx += ddfx;
+        dfy += ddfy;
+        ++_cpoint;
+        _cpoint->x = v0.x + RoundFix(fx);
+        _cpoint->y = v0.y + RoundFix(fy);
+    }
+    *++_cpoint = v2;
 }
 
 //---------------------------------------------------------------------
@@ -161,17 +290,24 @@ bool PathMgr::Bezier2(const SGPoint& v1, const SGPoint& v2)
 
 bool PathMgr::PolyBezier2(const SGPoint xy[], int npts)
 {
-    const SGPoint *pxy = xy;
+    const int BATCHLEN = 2*32;
+    VERT16 v[BATCHLEN];
 
     if (_cpoint == 0 || npts < 0 || xy == 0)
     {
         assert(_cpoint != 0 && npts >= 0 && xy != 0);
         return false;
     }
-    for (int i = 0; i < npts; i += 2)
+
+    // Convert the points in batches, and then flatten the curves
+    npts -= npts % 2;
+    for (int i = 0; i < npts; i += BATCHLEN)
     {
-        Bezier2(pxy[0], pxy[1]);
-        pxy = &pxy[2];
+        int count = min(npts - i, BATCHLEN);
+
+        UserToDevice(v, &xy[i], count);
+        for (int j = 0; j < count; j += 2)
+            Bezier2Core(v[j], v[j+1]);
     }
     return true;
 }
@@ -215,6 +351,32 @@ bool PathMgr::IsFlatCubic(const VERT16 v[4])
 //----------------------------------------------------------------------
 
 bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
+{
+    VERT16 v[3];
+
+    if (_cpoint == 0)
+    {
+        assert(_cpoint != 0);
+        return false;
+    }
+    UserToDevice(&v[0], v1.x, v1.y);
+    UserToDevice(&v[1], v2.x, v2.y);
+    UserToDevice(&v[2], v3.x, v3.y);
+    Bezier3Core(v[0], v[1], v[2]);
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Flattens a cubic Bezier curve and appends it to
+// the current figure. Does the work for the Bezier3 and PolyBezier3
+// functions. Parameters v1, v2, and v3 are the last three points in
+// the control polygon, which have already been converted to trans-
+// formed 16.16 fixed-point coordinates.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::Bezier3Core(const VERT16& v1, const VERT16& v2, const VERT16& v3)
 {
     VERT16 vstack[3*MAXLEVELS];  // stack for polygon vertices
     VERT16 *pvstk = &vstack[0];  // vertex stack pointer
@@ -223,26 +385,24 @@ bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
     int level = 0;               // current subdivision level
     VERT16 v[3+1][3+1];          // control polygon vertices
 
-    if (_cpoint == 0)
+    if (_flattenmode == FLATTENMODE_UNIFORM)
     {
-        assert(_cpoint != 0);
-        return false;
+        Bezier3Uniform(v1, v2, v3);
+        return;
     }
 
     // Get the four vertices for Bezier control polygon ABCD
-    v[0][0] = *_cpoint;             // A
-    v[0][1].x = v1.x << _fixshift;  // B
-    v[0][1].y = v1.y << _fixshift;
-    v[0][2].x = v2.x << _fixshift;  // C
-    v[0][2].y = v2.y << _fixshift;
-    v[0][3].x = v3.x << _fixshift;  // D
-    v[0][3].y = v3.y << _fixshift;
+    v[0][0] = *_cpoint;  // A
+    v[0][1] = v1;        // B
+    v[0][2] = v2;        // C
+    v[0][3] = v3;        // D
 
     // Continue to subdivide control polygon ABCD until the flatness
     // of each curve segment falls within the specified tolerance
     for (;;)
     {
-        while (!IsFlatCubic(v[0]) && level < MAXLEVELS)
+        while (!IsFlatCubic(v[0]) && !IsCulled(v[0], 4) &&
+               level < MAXLEVELS)
         {
             // Subdivide control polygon ABCD into AEHJ and JIGD
             for (int j = 1; j <= 3; ++j)
@@ -279,7 +439,61 @@ bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
         v[0][2] = *--pvstk;  // C
         v[0][3] = *--pvstk;  // D
     }
-    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Flattens a cubic Bezier curve into line segments
+// of equal parameter length, and appends the points to the current
+// figure. The control polygon is the current point, v1, v2, and v3.
+// This function works like the Bezier2Uniform function.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::Bezier3Uniform(const VERT16& v1, const VERT16& v2, const VERT16& v3)
+{
+    VERT16 v0 = *_cpoint;
+    FIX16 ddx1 = v0.x - 2*v1.x + v2.x;
+    FIX16 ddy1 = v0.y - 2*v1.y + v2.y;
+    FIX16 ddx2 = v1.x - 2*v2.x + v3.x;
+    FIX16 ddy2 = v1.y - 2*v2.y + v3.y;
+    FIX16 dmax = max(VLen(ddx1, ddy1), VLen(ddx2, ddy2));
+    int nsteps = WangSteps(dmax, 6.0f/8, _flatness);
+    VERT16 vc[4] = { v0, v1, v2, v3 };
+
+    if (IsCulled(vc, 4))
+        nsteps = 1;  // off-screen curve is replaced by its chord
+
+    // Make room for all the points in the path
+    while (&_cpoint[nsteps] >= &_path[_pathlength])
+        GrowPath();
+
+    // Polynomial coefficients: B(t) = v0 + c*t + b*t^2 + a*t^3
+    float h = 1.0f/nsteps;
+    float ax = float(v3.x - v0.x) - 3.0f*(v2.x - v1.x);
+    float ay = float(v3.y - v0.y) - 3.0f*(v2.y - v1.y);
+    float bx = 3.0f*ddx1, by = 3.0f*ddy1;
+    float cx = 3.0f*(v1.x - v0.x), cy = 3.0f*(v1.y - v0.y);
+
+    // Forward differences for step size h
+    float fx = 0, fy = 0;
+    float dfx = (ax*h + bx)*h*h + cx*h, dfy = (ay*h + by)*h*h + cy*h;
+    float ddfx = (6.0f*ax*h + 2.0f*bx)*h*h, ddfy = (6.0f*ay*h + 2.0f*by)*h*h;
+    float dddfx = 6.0f*ax*h*h*h, dddfy = 6.0f*ay*h*h*h;
+
+    for (int i = 1; i < nsteps; ++i)
+    {
+        fx += dfx;
+        fy += dfy;
+        dfx += ddfx;
+        dfy += ddfy;
+        ddfx += dddfx;
+        ddfy += dddfy;
+        ++_cpoint;
+        _cpoint->x = v0.x + RoundFix(fx);
+        _cpoint->y = v0.y + RoundFix(fy);
+    }
+    *++_cpoint = v3;
 }
 
 //---------------------------------------------------------------------
@@ -298,18 +512,58 @@ bool PathMgr::Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3)
 
 bool PathMgr::PolyBezier3(const SGPoint xy[], int npts)
 {
-    const SGPoint *pxy = xy;
+    const int BATCHLEN = 3*32;
+    VERT16 v[BATCHLEN];
 
     if (_cpoint == 0 || npts < 0 || xy == 0)
     {
         assert(_cpoint != 0 && npts >= 0 && xy != 0);
         return false;
     }
-    for (int i = 0; i < npts; i += 3)
+
+    // Convert the points in batches, and then flatten the curves
+    npts -= npts % 3;
+    for (int i = 0; i < npts; i += BATCHLEN)
     {
-        Bezier3(pxy[0], pxy[1], pxy[2]);
-        pxy = &pxy[3];
+        int count = min(npts - i, BATCHLEN);
+
+        UserToDevice(v, &xy[i], count);
+        for (int j = 0; j < count; j += 3)
+            Bezier3Core(v[j], v[j+1], v[j+2]);
     }
     return true;
 }
 
+
+//---------------------------------------------------------------------
+//
+// Public function: Appends a series of connected cubic Bezier curves
+// to the current figure, like the PolyBezier3 function, but the
+// points are specified as floating-point user coordinates. Array xy
+// contains 2*npts elements: x0, y0, x1, y1, and so on.
+//
+//----------------------------------------------------------------------
+
+bool PathMgr::PolyBezier3F(const float xy[], int npts)
+{
+    const int BATCHLEN = 3*32;
+    VERT16 v[BATCHLEN];
+
+    if (_cpoint == 0 || npts < 0 || xy == 0)
+    {
+        assert(_cpoint != 0 && npts >= 0 && xy != 0);
+        return false;
+    }
+
+    // Convert the points in batches, and then flatten the curves
+    npts -= npts % 3;
+    for (int i = 0; i < npts; i += BATCHLEN)
+    {
+        int count = min(npts - i, BATCHLEN);
+
+        FloatToDevice(v, &xy[2*i], count);
+        for (int j = 0; j < count; j += 3)
+            Bezier3Core(v[j], v[j+1], v[j+2]);
+    }
+    return true;
+}
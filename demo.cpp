@@ -2595,6 +2595,259 @@ void demo18(const PIXEL_BUFFER& bkbuf, const SGRect& clip)
     }
 }
 
+// Demo frame 19: Cached text labels
+void demo19(const PIXEL_BUFFER& bkbuf, const SGRect& clip)
+{
+    SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(&bkbuf));
+    SmartPtr<ShapeGen> sg(CreateShapeGen(&(*aarend), clip));
+    TextApp txt;
+    COLOR crBkgd = RGBX(236,240,244);
+    COLOR crFrame = RGBX(112,128,144);
+    COLOR crPanel = RGBX(32,40,52);
+    COLOR crLabel = RGBX(170,230,170);
+    COLOR crText = RGBX(255,200,80);
+
+    // Fill background and draw a frame around the window
+    SGPoint corner = { 40, 40 };
+    SGRect frame = { 10, 10, DEMO_WIDTH-20, DEMO_HEIGHT-20 };
+    sg->BeginPath();
+    sg->RoundedRectangle(frame, corner);
+    aarend->SetColor(crBkgd);
+    sg->FillPath();
+    sg->SetLineWidth(8.0);
+    aarend->SetColor(crFrame);
+    sg->StrokePath();
+
+    // Draw the title text
+    char *str = "Cached Text Labels";
+    SGPoint xystart;
+    float scale = 0.9;
+    txt.SetTextSpacing(1.1);
+    float wide = txt.GetTextWidth(scale, str);
+    xystart.x = (DEMO_WIDTH - wide)/2;
+    xystart.y = 140;
+    aarend->SetColor(RGBX(40,60,100));
+    sg->SetLineWidth(9.0);
+    txt.DisplayText(&(*sg), xystart, scale, str);
+
+    // Draw two status panels with the same labels. The labels in the
+    // left panel are stroked by DisplayText. The labels in the right
+    // panel are painted from cached glyph masks by DisplayCachedText.
+    char *label[] = {
+        "PUMP 1   RUNNING", "PUMP 2   STANDBY", "FLOW     42.7 L/MIN",
+        "PRESS    3.18 BAR", "TEMP     71.4 DEG C", "VALVE A  OPEN",
+        "VALVE B  CLOSED", "ALARMS   NONE",
+    };
+    char *caption[] = { "DisplayText", "DisplayCachedText" };
+    for (int k = 0; k < 2; ++k)
+    {
+        SGRect panel = { 60 + 600*k, 200, 560, 680 };
+        SGPoint round = { 16, 16 };
+        sg->BeginPath();
+        sg->RoundedRectangle(panel, round);
+        aarend->SetColor(crPanel);
+        sg->FillPath();
+
+        xystart.x = panel.x + 30;
+        xystart.y = panel.y + 60;
+        sg->SetLineWidth(3.0);
+        aarend->SetColor(crText);
+        txt.DisplayText(&(*sg), xystart, 0.4, caption[k]);
+
+        sg->SetLineWidth(2.0);
+        xystart.y += 30;
+        for (int i = 0; i < ARRAY_LEN(label); ++i)
+        {
+            xystart.y += 66;
+            if (k == 0)
+            {
+                aarend->SetColor(crLabel);
+                txt.DisplayText(&(*sg), xystart, 0.3, label[i]);
+            }
+            else
+                txt.DisplayCachedText(&(*sg), &(*aarend), crLabel,
+                                      xystart, 0.3, label[i]);
+        }
+    }
+}
+
+// Demo frame 20: Decimated polylines
+void demo20(const PIXEL_BUFFER& bkbuf, const SGRect& clip)
+{
+    SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(&bkbuf));
+    SmartPtr<ShapeGen> sg(CreateShapeGen(&(*aarend), clip));
+    TextApp txt;
+    COLOR crBkgd = RGBX(236,240,244);
+    COLOR crFrame = RGBX(112,128,144);
+    COLOR crPanel = RGBX(32,40,52);
+    COLOR crGrid = RGBX(60,72,88);
+    COLOR crTrace = RGBX(120,230,255);
+    COLOR crText = RGBX(255,200,80);
+
+    // Fill background and draw a frame around the window
+    SGPoint corner = { 40, 40 };
+    SGRect frame = { 10, 10, DEMO_WIDTH-20, DEMO_HEIGHT-20 };
+    sg->BeginPath();
+    sg->RoundedRectangle(frame, corner);
+    aarend->SetColor(crBkgd);
+    sg->FillPath();
+    sg->SetLineWidth(8.0);
+    aarend->SetColor(crFrame);
+    sg->StrokePath();
+
+    // Draw the title text
+    char *str = "Decimated Polylines";
+    SGPoint xystart;
+    float scale = 0.9;
+    txt.SetTextSpacing(1.1);
+    float wide = txt.GetTextWidth(scale, str);
+    xystart.x = (DEMO_WIDTH - wide)/2;
+    xystart.y = 110;
+    aarend->SetColor(RGBX(40,60,100));
+    sg->SetLineWidth(9.0);
+    txt.DisplayText(&(*sg), xystart, scale, str);
+
+    // Plot the same series of 200,000 points in two panels. The trace
+    // in the top panel is drawn by PolyLine, and the trace in the
+    // bottom panel is drawn by PolyLineDecimated, which keeps only the
+    // points that define the vertical extent of each 1/8-pixel column.
+    const int NPTS = 200000, BATCHLEN = 1000;
+    const SGCoord W = 1080, H = 200;
+    SGPoint xy[BATCHLEN];
+    char *caption[] = { "PolyLine", "PolyLineDecimated" };
+    for (int k = 0; k < 2; ++k)
+    {
+        SGRect panel = { 60, 150 + 290*k, 1160, 270 };
+        SGPoint round = { 16, 16 };
+        sg->BeginPath();
+        sg->RoundedRectangle(panel, round);
+        aarend->SetColor(crPanel);
+        sg->FillPath();
+
+        xystart.x = panel.x + 30;
+        xystart.y = panel.y + 40;
+        sg->SetLineWidth(3.0);
+        aarend->SetColor(crText);
+        txt.DisplayText(&(*sg), xystart, 0.35, caption[k]);
+
+        // Draw horizontal grid lines
+        SGCoord x0 = panel.x + 40, y0 = panel.y + 55;
+        sg->BeginPath();
+        for (int i = 0; i <= 4; ++i)
+        {
+            sg->Move(x0, y0 + i*H/4);
+            sg->Line(x0 + W, y0 + i*H/4);
+        }
+        sg->SetLineWidth(1.0);
+        aarend->SetColor(crGrid);
+        sg->StrokePath();
+
+        // Generate the points in batches, in 16.16 fixed-point format:
+        // a slow sweep plus a faster tone, with uniform noise added
+        unsigned int seed = 12345;
+        sg->SetFixedBits(16);
+        sg->BeginPath();
+        for (int i = 0; i < NPTS; i += BATCHLEN)
+        {
+            int len = min(BATCHLEN, NPTS - i);
+            for (int j = 0; j < len; ++j)
+            {
+                float t = float(i + j)/(NPTS - 1);
+                float y = 0.55*sin(2*PI*(3*t + 4*t*t)) +
+                          0.2*sin(2*PI*41*t);
+                seed = 1103515245*seed + 12345;
+                y += 0.18*((seed >> 16 & 0x7fff)/32768.0 - 0.5);
+                xy[j].x = 65536*(x0 + W*t);
+                xy[j].y = 65536*(y0 + H*(0.5 - 0.5*y));
+            }
+            if (i == 0)
+            {
+                sg->Move(xy[0].x, xy[0].y);
+                if (k == 0)
+                    sg->PolyLine(&xy[1], len - 1);
+                else
+                    sg->PolyLineDecimated(&xy[1], len - 1);
+            }
+            else if (k == 0)
+                sg->PolyLine(xy, len);
+            else
+                sg->PolyLineDecimated(xy, len);
+        }
+        aarend->SetColor(crTrace);
+        sg->StrokePath();
+        sg->SetFixedBits(0);
+    }
+
+    // Magnify the same small region of the two traces, and the
+    // difference between them, so that the differences (less than one
+    // column width) near the peaks of the trace are visible
+    const int MAG = 6, ZW = 60, ZH = 30;
+    SGRect zoom[2] = { { 150, 232, ZW, ZH }, { 150, 232 + 290, ZW, ZH } };
+    PIXEL_BUFFER backbuf, subbuf[2];
+    bool status = aarend->GetPixelBuffer(&backbuf);
+    assert(status);
+    for (int k = 0; k < 2; ++k)
+    {
+        status = DefineSubregion(subbuf[k], backbuf, zoom[k]);
+        assert(status);
+    }
+    COLOR diff[ZW*ZH];
+    for (int i = 0; i < ZH; ++i)
+    {
+        int offset = i*subbuf[0].pitch;
+        const COLOR *pix0 = (COLOR*)((char*)subbuf[0].pixels + offset);
+        const COLOR *pix1 = (COLOR*)((char*)subbuf[1].pixels + offset);
+        for (int j = 0; j < ZW; ++j)
+        {
+            COLOR color = 0xff000000;
+            for (int shift = 0; shift < 24; shift += 8)
+            {
+                int c0 = pix0[j] >> shift & 255, c1 = pix1[j] >> shift & 255;
+                int delta = (c0 > c1) ? c0 - c1 : c1 - c0;
+                color |= min(255, 8*delta) << shift;
+            }
+            diff[i*ZW + j] = color;
+        }
+    }
+    char *label[] = { "PolyLine", "PolyLineDecimated", "Difference x8" };
+    for (int k = 0; k < 3; ++k)
+    {
+        SGRect inset = { 60 + 400*k, 758, MAG*ZW, MAG*ZH };
+        float xform[6] = {
+            1.0f/MAG, 0, 0, 1.0f/MAG, -inset.x/MAG, -inset.y/MAG
+        };
+        aarend->SetTransform(xform);
+        if (k < 2)
+            aarend->SetPattern(subbuf[k].pixels, 0, 0, ZW, ZH,
+                               subbuf[k].pitch/sizeof(COLOR),
+                               FLAG_IMAGE_BGRA32);
+        else
+            aarend->SetPattern(diff, 0, 0, ZW, ZH, ZW, FLAG_IMAGE_BGRA32);
+
+        sg->BeginPath();
+        sg->Rectangle(inset);
+        sg->FillPath();
+        aarend->SetTransform(0);
+        aarend->SetColor(crFrame);
+        sg->SetLineWidth(2.0);
+        sg->StrokePath();
+
+        xystart.x = inset.x;
+        xystart.y = inset.y - 12;
+        aarend->SetColor(crPanel);
+        txt.DisplayText(&(*sg), xystart, 0.25, label[k]);
+    }
+
+    // Outline the magnified regions in the two panels
+    for (int k = 0; k < 2; ++k)
+    {
+        sg->BeginPath();
+        sg->Rectangle(zoom[k]);
+        aarend->SetColor(crFrame);
+        sg->StrokePath();
+    }
+}
+
 // First code example from UG topic "Creating a ShapeGen object"
 void MySub(ShapeGen *sg, SGRect& rect)
 {
@@ -4373,7 +4626,7 @@ void (*testfunc[])(const PIXEL_BUFFER& bkbuf, const SGRect& cliprect) =
     demo04, demo05, demo06, demo07,
     demo08, demo09, demo10, demo11,
     demo12, demo13, demo14, demo15,
-    demo16, demo17, demo18,
+    demo16, demo17, demo18, demo19, demo20,
 
     // Code examples from userdoc.pdf
     MyTest, MyTest2, EggRoll, PieToss,
@@ -104,9 +104,13 @@ class BmpReader : public ImageReader
     int _height;   // height of bitmap, in pixels
     int _bpp;      // bits per pixel
     bool _bAlpha;  // true if BMP file data has 8-bit alpha channel
-    int _row;      // current row in bitmap
-    int _col;      // current column in bitmap
+    int _row;      // number of rows read from bitmap
+    int _col;      // current column in last row read
     int _pad;      // bytes of padding at end of each row in file
+    char _name[256];  // file name (identifies image for reuse)
+    long _mtime;   // file modification time
+    long _fsize;   // file size, in bytes
+    unsigned char *_rowbuf;  // holds one row of pixel data from file
 
     void ErrorMessage(char *pszError);
 
@@ -116,6 +120,8 @@ public:
     bool GetImageInfo(int *width, int *height, int *flags);
     int ReadPixels(COLOR *buffer, int count);
     bool RewindData();
+    const char* GetImageName();
+    void GetImageStamp(long *mtime, long *size);
 };
 
 //---------------------------------------------------------------------
@@ -131,15 +137,26 @@ struct XY
 };
 
 struct GLYPH;
+struct GLYPHMASK;
+
+const int GLYPHMASK_HASHLEN = 64;   // hash table length for mask cache
+const int GLYPHMASK_MAXCOUNT = 512; // max number of cached glyph masks
+const int GLYPH_MAXPOINTS = 23;     // max number of x-y points per glyph
 
 class TextApp
 {
-    GLYPH *_glyphtbl[128];  // glyph look-up table
-    GLYPH *_glyph;          // glyph display lists
+    SGPoint _xy[GLYPH_MAXPOINTS];  // transformed x-y coords (16.16)
     float _width;           // current stroke width
     float _xspace;          // text spacing multiplier
+    GLYPHMASK *_maskhash[GLYPHMASK_HASHLEN];  // glyph mask cache
+    int _maskcount;         // number of glyph masks in cache
+    unsigned char *_textmask;  // coverage mask for entire string
+    int _textmasklen;       // length of _textmask buffer in bytes
 
-    void DrawGlyph(ShapeGen *sg, char *displist, SGPoint xy[]);
+    void DrawGlyph(ShapeGen *sg, const char *displist, SGPoint xy[]);
+    SGPoint* TransformGlyph(const GLYPH *p, const float xform[], const XY& pos);
+    GLYPHMASK* GetGlyphMask(const GLYPH *p, float scale, int subx);
+    void FlushGlyphMasks();
 
 public:
     TextApp();
@@ -147,6 +164,10 @@ public:
     void SetTextSpacing(float xspace);
     void DisplayText(ShapeGen *sg, const float xform[], const char *str);
     void DisplayText(ShapeGen *sg, SGPoint xystart, float scale, const char *str);
+    void DisplayCachedText(ShapeGen *sg, EnhancedRenderer *aarend, COLOR color,
+                           SGPoint xystart, float scale, const char *str);
+    int GetGlyphPositions(const float xform[], const char *str,
+                          XY xypos[], int maxcount);
     void GetTextEndpoint(const float xform[], const char *str, XY *xyout);
     float GetTextWidth(float scale, const char *str);
 };
@@ -157,25 +178,41 @@ public:
 // typically used to draw drop shadows. The AlphaBlur class is
 // implemented in alfablur.cpp.
 //
+// If the filter kernel's radius, floor(kwidth/2), exceeds the 'maxrad'
+// constructor parameter, the Gaussian is approximated by three
+// successive box filters. Each box filter uses a running sum, so the
+// cost per pixel doesn't depend on the radius. Compared to the exact
+// Gaussian filter, each 8-bit alpha value in the blurred image differs
+// by no more than 18 (out of 255), and the RMS difference over the
+// image is typically less than 2.
+//
 //---------------------------------------------------------------------
 
+const int BLUR_MAX_GAUSSIAN_RADIUS = 16;  // default 'maxrad' value
+
 class AlphaBlur : public ImageReader
 {
     int _kwidth;            // width of Gaussian kernel (always odd)
     float _stddev;          // standard deviation
     COLOR *_kcoeff;         // kernel coefficients
+    int _maxrad;            // max radius for exact Gaussian filter
+    int _boxrad[3];         // radii of box filters if kwidth/2 > maxrad
+    COLOR *_boxbuf[2];      // scratch buffers for box filters
     COLOR _rgba, _rgb, _alpha;  // fill color components
     PIXEL_BUFFER _blurbuf;  // buffer containing blurred image
     int _numpixels;         // number of pixels in blurred image
     int _index;             // current index into blurred image
 
+    void ApplyFilter(COLOR dst[], const COLOR src[], int len);
     void ApplyGaussianFilter(COLOR dst[], const COLOR src[], int len);
+    void ApplyBoxFilters(COLOR dst[], const COLOR src[], int len);
     bool CreateFilterKernel(int kwidth, float stddev);
     bool BlurImage(const PIXEL_BUFFER *srcimage);
 
 public:
     AlphaBlur(const PIXEL_BUFFER *srcimage, int kwidth = 0,
-              float stddev = 0, COLOR color = RGBA(0,0,0,127));
+              float stddev = 0, COLOR color = RGBA(0,0,0,127),
+              int maxrad = BLUR_MAX_GAUSSIAN_RADIUS);
     ~AlphaBlur();
     bool GetBlurParams(int *kwidth, float *stddev, COLOR *color);
     bool GetBlurredBoundingBox(SGRect *blurbbox, const SGRect *bbox);
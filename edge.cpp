@@ -153,6 +153,52 @@ namespace {
         }
         return head;
     }
+
+    //---------------------------------------------------------------------
+    //
+    // Sorts a singly linked EDGE list that consists of at most two runs
+    // of edges in ascending-y order. The list is split at the end of the
+    // first run, and the two runs are merged. If the list contains more
+    // than two runs, the output list is not fully sorted.
+    //
+    //---------------------------------------------------------------------
+
+    EDGE* mergeruns(EDGE *plist)
+    {
+        EDGE *p = plist;
+
+        while (p->next != 0 && p->ytop <= p->next->ytop)
+            p = p->next;
+
+        EDGE *run = p->next;
+        p->next = 0;
+        return mergelists(plist, run);
+    }
+
+    //---------------------------------------------------------------------
+    //
+    // Returns true if the edges in a y-sorted list form an unbroken
+    // chain, so that each scan line between the top of the first edge
+    // and the bottom of the last edge is crossed by exactly one edge.
+    // Parameter ybot receives the y coordinate just past the bottom of
+    // the chain.
+    //
+    //---------------------------------------------------------------------
+
+    bool ischain(const EDGE *plist, int *ybot)
+    {
+        int y = plist->ytop;
+
+        for (const EDGE *p = plist; p != 0; p = p->next)
+        {
+            if (p->ytop != y)
+                return false;
+
+            y += abs(p->dy);
+        }
+        *ybot = y;
+        return true;
+    }
 }  // end namespace
 
 //---------------------------------------------------------------------
@@ -191,6 +237,19 @@ EDGE* POOL::Allocate(EDGE *p)
     return q;
 }
 
+// Public function: Reserves a contiguous array of EDGE structures in
+// the current block. On return, *len is the number of structures in
+// the array, which is at least 1. The structures are not allocated
+// until the caller passes the number it actually used to Commit.
+EDGE* POOL::Reserve(int *len)
+{
+    if (watermark == blklen)  // is this block exhausted?
+        AcquireBlock();  // yes, acquire more pool memory
+
+    *len = blklen - watermark;
+    return &block[watermark];
+}
+
 // Private function: Acquires more storage when pool is exhausted
 void POOL::AcquireBlock()
 {
@@ -435,7 +494,7 @@ bool Feeder::GetNextSGSpan(SGSpan *span)
 //
 //---------------------------------------------------------------------
 
-EdgeMgr::EdgeMgr() : _renderer(0)
+EdgeMgr::EdgeMgr() : _renderer(0), _bCull(false)
 {
     // TODO: Replace assert below with out-of-memory exception
     _inpool = new POOL;
@@ -445,6 +504,7 @@ EdgeMgr::EdgeMgr() : _renderer(0)
     _savepool = new POOL;
     assert(_inpool != 0 && _outpool != 0 && _clippool != 0 &&
            _rendpool != 0 && _savepool != 0);  // out of memory?
+    UpdateCullBounds();
 }
 
 EdgeMgr::~EdgeMgr()
@@ -475,9 +535,54 @@ bool EdgeMgr::SetRenderer(Renderer *renderer)
     _ybias = FIX_BIAS >> yres;
     _yhalf = _ybias + 1;
     _renderer = renderer;
+    UpdateCullBounds();  // y resolution might have changed
     return true;
 }
 
+//---------------------------------------------------------------------
+//
+// Protected function: Sets the rectangle that the AttachEdge and
+// AttachEdges functions use to cull new edges. Parameter rect is the
+// device clipping rectangle, specified in pixels, and its x and y
+// members are the current scroll position. (The rectangle is in the
+// same coordinate space as the path, before the edges are translated
+// by the scroll position.) If rect is 0, culling is disabled.
+//
+//---------------------------------------------------------------------
+
+void EdgeMgr::SetCullRectangle(const SGRect *rect)
+{
+    _bCull = (rect != 0);
+    if (rect != 0)
+        _cullrect = *rect;
+
+    UpdateCullBounds();
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Converts the culling rectangle to 16.16 fixed-
+// point x coordinates and scan line numbers. If culling is disabled,
+// the bounds are set so that no edge is ever culled.
+//
+//---------------------------------------------------------------------
+
+void EdgeMgr::UpdateCullBounds()
+{
+    if (_bCull == false)
+    {
+        _cullxmin = _cullytop = 0x80000000;
+        _cullxmax = _cullybot = 0x7fffffff;
+        return;
+    }
+    int yres = 16 - _yshift;
+
+    _cullxmin = _cullrect.x << 16;
+    _cullxmax = (_cullrect.x + _cullrect.w) << 16;
+    _cullytop = _cullrect.y << yres;
+    _cullybot = (_cullrect.y + _cullrect.h) << yres;
+}
+
 //---------------------------------------------------------------------
 //
 // Protected function: Sets the clipping region to the normalized edge
@@ -749,6 +854,47 @@ bool EdgeMgr::FillEdgeList()
     return true;
 }
 
+//---------------------------------------------------------------------
+//
+// Protected function: Invokes the renderer to update its clipping
+// mask with the shape defined by the (clipped and normalized) edges
+// in the _outlist.head list. Parameter op specifies whether the mask
+// is to be intersected with the interior or exterior of the shape.
+// Returns the renderer's indication of whether the updated mask is
+// not empty. An empty _outlist.head list is treated as an empty shape.
+//
+//---------------------------------------------------------------------
+
+bool EdgeMgr::SetClipMask(CLIPMASKOP op)
+{
+    Feeder iter;
+
+    assert(op == CLIPMASK_INTERSECT || op == CLIPMASK_EXCLUDE);
+    _rendlist.head = _outlist.head;
+    POOL *swap = _outpool;  _outpool = _rendpool;  _rendpool = swap;
+    _outlist.head = 0;
+    _outpool->Reset();
+    iter.SetEdgeList(_rendlist.head, _yshift);
+    return _renderer->UpdateClipMask(op, &iter);
+}
+
+//---------------------------------------------------------------------
+//
+// Protected function: Returns the number of edges in the normalized
+// edge list in _outlist.head
+//
+//---------------------------------------------------------------------
+
+int EdgeMgr::CountEdges()
+{
+    int count = 0;
+
+    for (EDGE *p = _outlist.head; p != 0; p = p->next)
+        ++count;
+
+    return count;
+}
+
 //---------------------------------------------------------------------
 //
 // Protected function: Saves the next pair of mated edges to the
@@ -797,12 +943,18 @@ void EdgeMgr::SetDeviceClipRectangle(int width, int height, bool bsave)
         _savepool->Reset();
     }
 
-    // Add left and right sides of rectangle to _inpool
+    // Add left and right sides of rectangle to _inpool. These edges
+    // are in device coordinates, so temporarily disable culling.
+    bool bcull = _bCull;
     VERT16 v1 = { width<<16, height<<16 };
     VERT16 v2 = { width<<16, 0 };
+    _bCull = false;
+    UpdateCullBounds();
     AttachEdge(&v1, &v2);
     v1.x = v2.x = 0;
     AttachEdge(&v2, &v1);  // <-- note reverse ordering
+    _bCull = bcull;
+    UpdateCullBounds();
 
     // Swap _inpool with _clippool, and reset _inpool
     _cliplist.head = _inlist.head;
@@ -811,6 +963,42 @@ void EdgeMgr::SetDeviceClipRectangle(int width, int height, bool bsave)
     _inpool->Reset();
 }
 
+//---------------------------------------------------------------------
+//
+// Protected function: Fills an axis-aligned rectangle without building
+// an edge list, if the clipping region is also a rectangle and the
+// renderer can fill rectangles directly. Parameters vmin and vmax are
+// the rectangle's top-left and bottom-right corners in 16.16 fixed-
+// point device coordinates. The rectangle is clipped exactly as the
+// ClipEdges function would clip the edges of the same rectangle, so
+// the renderer fills the same pixels. Returns false if the caller must
+// fill the rectangle through the edge list instead.
+//
+//----------------------------------------------------------------------
+
+bool EdgeMgr::FillRectangle(const VERT16 *vmin, const VERT16 *vmax)
+{
+    EDGE *p = _cliplist.head;
+
+    if (p == 0)
+        return true;  // clipping region is empty
+
+    EDGE *q = p->next;
+    if (q->next != 0 || p->dxdy != 0 || q->dxdy != 0)
+        return false;  // clipping region isn't a rectangle
+
+    assert(p->dy > 0 && p->xtop <= q->xtop);
+    FIX16 xL = max(vmin->x + FIX_BIAS, p->xtop);
+    FIX16 xR = min(vmax->x + FIX_BIAS, q->xtop);
+    int ytop = max((vmin->y + _ybias) >> _yshift, p->ytop);
+    int ybot = min((vmax->y + _ybias) >> _yshift, p->ytop + p->dy);
+    if (xL >= xR || ytop >= ybot)
+        return true;  // rectangle is clipped out
+
+    SGRect rect = { xL, ytop, xR - xL, ybot - ytop };
+    return _renderer->RenderRect(&rect);
+}
+
 //---------------------------------------------------------------------
 //
 // Protected function: Partition a complex polygonal shape (consisting
@@ -845,6 +1033,9 @@ void EdgeMgr::NormalizeEdges(FILLRULE fillrule)
     if (fillrule == FILLRULE_EVENODD || fillrule == FILLRULE_WINDING)
     {
         assert(_outlist.head == 0 && _outpool->GetCount() == 0);
+        if (NormalizeMonotoneEdges())
+            return;  // shape is y-monotone (e.g., convex)
+
         length = _inpool->GetCount();
         _inlist.head = sortlist(_inlist.head, length, ycomp);
     }
@@ -993,52 +1184,214 @@ void EdgeMgr::NormalizeEdges(FILLRULE fillrule)
 
 //---------------------------------------------------------------------
 //
-// Protected function: Converts a directed line segment (taken from a
-// path) to a polygonal edge and adds the edge to the input edge list.
-// Input parameters v1 and v2 specify the 16.16 fixed-point x-y coordi-
-// nates of the line's start and end points, respectively.
+// Private function: A fast path for NormalizeEdges. Most filled shapes
+// (rectangles, ellipses, rounded rectangles, and other convex polygons)
+// are y-monotone: each scan line crosses exactly two edges -- one that
+// points down and one that points up. For such a shape, the edges in
+// the input list split into a downward chain and an upward chain that
+// each cover the same range of scan lines, and each chain is already
+// in y order (except for a wraparound point). The chains are walked
+// side by side to produce the trapezoids, which eliminates the sorting
+// and banding in NormalizeEdges. The output is identical to that from
+// NormalizeEdges, for either fill rule. If the input list doesn't have
+// this form, the function leaves the edges in _inlist (in a different
+// order) and returns false.
 //
 //----------------------------------------------------------------------
 
-void EdgeMgr::AttachEdge(const VERT16 *v1, const VERT16 *v2)
+bool EdgeMgr::NormalizeMonotoneEdges()
 {
-    int j = (v1->y + _ybias) >> _yshift;
-    int k = (v2->y + _ybias) >> _yshift;
-    int dy = k - j;
+    EDGE *p, *q, *next, *down = 0, *up = 0, **tail = &up;
+    int runs = 0, ybot1, ybot2;
+    bool bdown = false;
 
-    // If edge is horizontal (j == k), discard it and return
-    if (dy)
+    // In a y-monotone figure, the edge directions in the input list
+    // (which is in reverse path order) change no more than twice
+    for (p = _inlist.head; p != 0; p = p->next)
     {
-        VERT16 vtop, vbot;
-        int ymin;
+        if (runs == 0 || (p->dy > 0) != bdown)
+        {
+            bdown = (p->dy > 0);
+            if (++runs > 3)
+                return false;
+        }
+    }
+    if (runs < 2)
+        return false;
 
-        // Identify top and bottom vertices on current edge
-        if (dy > 0)
+    // Split the edges into downward and upward chains. Reverse the
+    // order of the downward edges so that both chains consist of at
+    // most two runs of edges in ascending-y order.
+    for (p = _inlist.head; p != 0; p = next)
+    {
+        next = p->next;
+        if (p->dy > 0)
         {
-            vtop = *v1;
-            vbot = *v2;
-            ymin = j;
+            p->next = down;
+            down = p;
         }
         else
         {
-            vtop = *v2;
-            vbot = *v1;
-            ymin = k;
+            *tail = p;
+            tail = &(p->next);
         }
+    }
+    *tail = 0;
+    down = mergeruns(down);
+    up = mergeruns(up);
+    if (!ischain(down, &ybot1) || !ischain(up, &ybot2) ||
+        down->ytop != up->ytop || ybot1 != ybot2)
+    {
+        // Not y-monotone, so let NormalizeEdges sort the edges
+        for (p = down; p->next != 0; p = p->next)
+            ;
+        p->next = up;
+        _inlist.head = down;
+        return false;
+    }
 
-        // Prepare to snip off any small tip of the edge that lies
-        // above the topmost scanline that intersects the edge
-        float dx = vbot.x - vtop.x;
-        float dxdy = dx/(vbot.y - vtop.y);
-        FIX16 xgap = dxdy*((ymin << _yshift) + _yhalf - vtop.y);
-
-        // Create new EDGE structure and insert at head of _inlist.head
-        EDGE *p = _inpool->Allocate();
-        p->ytop = ymin;
-        p->dy = dy;  // sign of dy indicates edge up/down direction
-        p->xtop = vtop.x + xgap + FIX_BIAS;
-        p->dxdy = dxdy*(1 << _yshift);
-        p->next = _inlist.head;
-        _inlist.head = p;
+    // Each band contains one edge from each chain. Order the two edges
+    // and limit the band height exactly as NormalizeEdges does.
+    p = down;
+    q = up;
+    while (p != 0)
+    {
+        assert(q != 0 && p->ytop == q->ytop);
+        EDGE *edgeL = p, *edgeR = q;
+        if (xcomp(&edgeL, &edgeR) > 0)
+            edgeL = q, edgeR = p;
+
+        int h = min(abs(p->dy), abs(q->dy));
+        FIX16 ddx = edgeL->dxdy - edgeR->dxdy;
+        FIX16 xdist = edgeR->xtop - edgeL->xtop;
+        if (h > 1 && ddx > 0 && xdist < (h - 1)*ddx)
+            h = 1 + xdist/ddx;
+
+        SaveEdgePair(h, edgeL, edgeR);
+
+        // Cut off the parts of the two edges that lie within the band
+        p->dy -= h;
+        q->dy += h;
+        p->xtop += h*(p->dxdy);
+        q->xtop += h*(q->dxdy);
+        p->ytop += h;
+        q->ytop += h;
+        if (p->dy == 0)
+            p = p->next;
+        if (q->dy == 0)
+            q = q->next;
+    }
+    assert(q == 0);
+    _inlist.head = 0;
+    _inpool->Reset();
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Protected function: Converts a directed line segment (taken from a
+// path) to a polygonal edge and adds the edge to the input edge list.
+// Input parameters v1 and v2 specify the 16.16 fixed-point x-y coordi-
+// nates of the line's start and end points, respectively. The edge is
+// culled as described for the AttachEdges function.
+//
+//----------------------------------------------------------------------
+
+void EdgeMgr::AttachEdge(const VERT16 *v1, const VERT16 *v2)
+{
+    VERT16 pts[2];
+
+    pts[0] = *v1;
+    pts[1] = *v2;
+    AttachEdges(pts, 2, false);
+}
+
+//---------------------------------------------------------------------
+//
+// Protected function: Converts the connected line segments in a figure
+// to polygonal edges and adds the edges to the input edge list. Array
+// pts contains the figure's npts vertices in 16.16 fixed-point format.
+// If bclosed is true, the segment from the last point to the first
+// point is included (and is added first). This function produces the
+// same edges, in the same order, as calling AttachEdge once for each
+// segment, but it reserves pool storage for many edges at a time, and
+// the loop that calculates the edges contains no branches: horizontal
+// edges are written to the pool but are not committed.
+//
+// Edges are culled against the device clipping rectangle as they are
+// created, so that edges that can't affect the display don't have to
+// be sorted and clipped later. An edge that lies entirely above or
+// below the rectangle is discarded, and an edge that crosses the top
+// or bottom of the rectangle is trimmed. An edge that lies entirely
+// to the left or right of the rectangle is replaced by a vertical
+// edge on the left or right side of the rectangle, which preserves
+// the winding numbers (and the pairing of edges) inside the rectangle.
+// The culled edge list is filled with exactly the same pixels.
+//
+//----------------------------------------------------------------------
+
+void EdgeMgr::AttachEdges(const VERT16 *pts, int npts, bool bclosed)
+{
+    int nedges = (bclosed) ? npts : npts - 1;
+    const VERT16 *v1 = (bclosed) ? &pts[npts-1] : &pts[0];
+    const VERT16 *v2 = (bclosed) ? &pts[0] : &pts[1];
+    EDGE *head = _inlist.head;
+
+    while (nedges > 0)
+    {
+        int len, used = 0;
+        EDGE *edge = _inpool->Reserve(&len);
+        int count = min(len, nedges);
+
+        for (int i = 0; i < count; ++i)
+        {
+            int j = (v1->y + _ybias) >> _yshift;
+            int k = (v2->y + _ybias) >> _yshift;
+            bool down = (k > j);
+            const VERT16 *vtop = (down) ? v1 : v2;
+            const VERT16 *vbot = (down) ? v2 : v1;
+            int ymin = (down) ? j : k;
+            int ymax = (down) ? k : j;
+
+            // Snip off any small tip above the topmost scanline (a
+            // horizontal edge has a dummy denominator of 1)
+            int ydiff = vbot->y - vtop->y;
+            float dx = vbot->x - vtop->x;
+            float dxdy = dx/(ydiff + (ydiff == 0));
+            FIX16 xgap = dxdy*((ymin << _yshift) + _yhalf - vtop->y);
+            FIX16 xtop = vtop->x + xgap + FIX_BIAS;
+            FIX16 dxdy16 = dxdy*(1 << _yshift);
+
+            // Trim the edge to the culling rectangle's scan lines. (An
+            // edge that is horizontal or lies above or below the
+            // rectangle is left with no scan lines, and is discarded.)
+            int y0 = max(ymin, _cullytop);
+            int y1 = min(ymax, _cullybot);
+            xtop += (y0 - ymin)*dxdy16;
+
+            // Move an edge that's to the left or right of the culling
+            // rectangle to the side of the rectangle
+            FIX16 xlo = min(v1->x, v2->x);
+            FIX16 xhi = max(v1->x, v2->x);
+            bool left = (xhi <= _cullxmin);
+            bool right = (xlo >= _cullxmax);
+            xtop = (left) ? _cullxmin + FIX_BIAS : xtop;
+            xtop = (right) ? _cullxmax + FIX_BIAS : xtop;
+            dxdy16 = (left || right) ? 0 : dxdy16;
+
+            EDGE *p = &edge[used];
+            bool keep = (y0 < y1);
+            p->ytop = y0;
+            p->dy = (down) ? y1 - y0 : y0 - y1;  // sign = up/down direction
+            p->xtop = xtop;
+            p->dxdy = dxdy16;
+            p->next = head;
+            head = (keep) ? p : head;
+            used += keep;
+            v1 = v2++;
+        }
+        _inpool->Commit(used);
+        nedges -= count;
     }
+    _inlist.head = head;
 }
@@ -39,6 +39,42 @@ struct STOP_COLOR
     COLOR rb;      // format = 0x00bb00rr
 };
 
+namespace {
+    // A partial derivative whose magnitude is smaller than this value
+    // cannot change the 16-bit fraction in color look-up parameter t
+    // by even one LSB over the width of the widest possible span
+    const float DERIV_EPSILON = 1.0f/(65536.0f*0x7fff);
+
+    // Multiplies a 32-bit pixel's RGB and alpha components by the
+    // 'opacity' parameter, which is an alpha value in the range 0
+    // to 255. Both the input pixel value and the return value are
+    // in premultiplied-alpha format. For a given gradient color,
+    // the result is identical to the color that ColorStops returns
+    // when it is called with the same 'opacity' value.
+    inline COLOR MultiplyByOpacity(COLOR pixel, COLOR opacity)
+    {
+        COLOR rb, ga;
+
+        if (opacity == 255)
+            return pixel;
+
+        if (opacity == 0 || pixel == 0)
+            return 0;
+
+        rb = pixel & 0x00ff00ff;
+        rb *= opacity;
+        rb += 0x00800080;
+        rb += (rb >> 8) & 0x00ff00ff;
+        rb = (rb >> 8) & 0x00ff00ff;
+        ga = (pixel >> 8) & 0x00ff00ff;
+        ga *= opacity;
+        ga += 0x00800080;
+        ga += (ga >> 8) & 0x00ff00ff;
+        ga &= 0xff00ff00;
+        return ga | rb;
+    }
+}
+
 //---------------------------------------------------------------------
 //
 // ColorStops class -- The gradient color-stop array manager
@@ -278,13 +314,20 @@ class LinearGrad : public LinearGradient
     COLOR _endColor;        // ending color if SPREAD_PAD
     int _xscroll, _yscroll; // scroll position coordinates
     bool _bSpecial;         // special case x0==x1 and y0==y1
+    bool _bRowInvariant;    // dt/dy == 0, so all rows are identical
+    bool _bColInvariant;    // dt/dx == 0, so each row is one color
+    COLOR *_rowcache;       // cached row of colors if _bRowInvariant
+    int _rowx, _rowlen;     // x coord and length of cached row
 
     // These values are constant over the lifetime of the object
     float _dtdx;  // partial derivative dt/dx
     float _dtdy;  // partial derivative dt/dy
 
+    COLOR GetColor(float t, COLOR opacity);
+    const COLOR* GetCachedRow(int x, int len);
+
 public:
-    LinearGrad() : _cstops(0)
+    LinearGrad() : _cstops(0), _rowcache(0)
     {
         assert(_cstops != 0);
     }
@@ -293,6 +336,7 @@ public:
     ~LinearGrad()
     {
         delete _cstops;
+        delete[] _rowcache;
     }
     bool GetStatus()
     {
@@ -301,6 +345,7 @@ public:
     void FillSpan(int xs, int ys, int length, COLOR outBuf[], const COLOR inAlpha[]);
     bool AddColorStop(float offset, COLOR color)
     {
+        _rowlen = 0;  // color stops changed, so flush row cache
         return _cstops->AddColorStop(offset, color);
     }
     bool SetScrollPosition(int x, int y)
@@ -313,7 +358,9 @@ public:
 // Constructor: Defines a new linear-gradient fill pattern
 LinearGrad::LinearGrad(float x0, float y0, float x1, float y1,
                        SPREAD_METHOD spread, int flags, const float xform[6]) :
-              _x0(x0), _y0(y0), _x1(x1), _y1(y1), _xscroll(0), _yscroll(0)
+              _x0(x0), _y0(y0), _x1(x1), _y1(y1), _xscroll(0), _yscroll(0),
+              _bRowInvariant(false), _bColInvariant(false),
+              _rowcache(0), _rowx(0), _rowlen(0)
 {
     _cstops = new ColorStops();
     assert(_cstops);  // out of memory?
@@ -357,6 +404,86 @@ LinearGrad::LinearGrad(float x0, float y0, float x1, float y1,
 
     _dtdx = _x1/dist2;
     _dtdy = _y1/dist2;
+
+    // UI backgrounds and chart fills are usually axis-aligned. If the
+    // gradient varies only in x, every scanline is identical and can
+    // be copied from a cached row. If it varies only in y, each
+    // scanline is painted a single color.
+    if (fabs(_dtdy) < DERIV_EPSILON)
+        _bRowInvariant = true, _dtdy = 0;
+    else if (fabs(_dtdx) < DERIV_EPSILON)
+        _bColInvariant = true, _dtdx = 0;
+}
+
+// Private function: Calculates the color of a pixel given the
+// color look-up parameter 't' at the pixel's center. The 'opacity'
+// parameter is an alpha value in the range 1 to 255. Returns the
+// pixel color in premultiplied-alpha format. The color is zero
+// (transparent) if 't' lies outside the extent of the gradient.
+COLOR LinearGrad::GetColor(float t, COLOR opacity)
+{
+    COLOR color = 0;
+    bool bValid = ((_bExtStart || t >= 0) && (_bExtEnd || t < 1.0));
+
+    if (bValid)
+    {
+        int n = t;
+
+        if (t < 0) --n;
+        if (_spread == SPREAD_PAD && n != 0)
+            color = _cstops->GetPadColor(n, opacity);
+        else
+        {
+            // Convert t from float to 16.16 fixed-point format. We
+            // represent 1.0 as 0x0000ffff instead of as 0x00010000
+            // to help distinguish 1.0 from 0 at boundaries between
+            // color patterns when spread == SPREAD_REFLECT.
+            FIX16 tfix = 0x0000ffff*(t - n);
+
+            if (_spread == SPREAD_REFLECT && (n & 1))
+                tfix ^= 0x0000ffff;
+
+            color = _cstops->GetColorValue(tfix, opacity);
+        }
+    }
+    return color;
+}
+
+// Private function: Returns a pointer to the cached, fully opaque
+// colors for the 'len' pixels that start at pattern-relative x
+// coordinate 'x'. This function is used only if the gradient is
+// row-invariant. The cache grows to cover the union of all spans
+// requested so far, and only the newly covered pixels are painted.
+const COLOR* LinearGrad::GetCachedRow(int x, int len)
+{
+    if (_rowlen == 0 || x < _rowx || _rowx + _rowlen < x + len)
+    {
+        int xmin = x, xmax = x + len;
+
+        if (_rowlen != 0)
+        {
+            xmin = min(xmin, _rowx);
+            xmax = max(xmax, _rowx + _rowlen);
+        }
+        COLOR *buf = new COLOR[xmax - xmin];
+        assert(buf);  // out of memory?
+        if (_rowlen != 0)
+            memcpy(&buf[_rowx - xmin], _rowcache, _rowlen*sizeof(COLOR));
+
+        for (int i = xmin; i < xmax; ++i)
+        {
+            if (_rowlen != 0 && i == _rowx)
+                i += _rowlen;  // skip over previously cached colors
+
+            if (i < xmax)
+                buf[i - xmin] = GetColor((i - _x0)*_dtdx, 255);
+        }
+        delete[] _rowcache;
+        _rowcache = buf;
+        _rowx = xmin;
+        _rowlen = xmax - xmin;
+    }
+    return &_rowcache[x - _rowx];
 }
 
 // Public function: Fills the pixels in a single horizontal span with
@@ -388,39 +515,57 @@ void LinearGrad::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR i
     float yp = ys - _y0 + _yscroll;
     float t = xp*_dtdx + yp*_dtdy;
 
-    // Normal case: Each iteration of this for-loop paints one pixel
-    for (int i = 0; i < len; ++i)
+    // Special case: dt/dx == 0, so the entire span is one color
+    if (_bColInvariant)
     {
-        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
+        COLOR color = GetColor(t, 255);
 
-        if (opacity != 0)
+        if (inAlpha == 0)
         {
-            COLOR color = 0;
-            bool bValid = ((_bExtStart || t >= 0) && (_bExtEnd || t < 1.0));
-
-            if (bValid)
+            for (int i = 0; i < len; ++i)
+                outBuf[i] = color;
+        }
+        else
+        {
+            for (int i = 0; i < len; ++i)
             {
-                int n = t;
+                COLOR opacity = inAlpha[i];
 
-                if (t < 0) --n;
-                if (_spread == SPREAD_PAD && n != 0)
-                    color = _cstops->GetPadColor(n, opacity);
-                else
-                {
-                    // Convert t from float to 16.16 fixed-point format. We
-                    // represent 1.0 as 0x0000ffff instead of as 0x00010000
-                    // to help distinguish 1.0 from 0 at boundaries between
-                    // color patterns when spread == SPREAD_REFLECT.
-                    FIX16 tfix = 0x0000ffff*(t - n);
+                if (opacity != 0)
+                    outBuf[i] = MultiplyByOpacity(color, opacity);
+            }
+        }
+        return;
+    }
 
-                    if (_spread == SPREAD_REFLECT && (n & 1))
-                        tfix ^= 0x0000ffff;
+    // Special case: dt/dy == 0, so copy the span from the cached row
+    if (_bRowInvariant)
+    {
+        const COLOR *row = GetCachedRow(xs + _xscroll, len);
 
-                    color = _cstops->GetColorValue(tfix, opacity);
-                }
+        if (inAlpha == 0)
+            memcpy(outBuf, row, len*sizeof(outBuf[0]));
+        else
+        {
+            for (int i = 0; i < len; ++i)
+            {
+                COLOR opacity = inAlpha[i];
+
+                if (opacity != 0)
+                    outBuf[i] = MultiplyByOpacity(row[i], opacity);
             }
-            outBuf[i] = color;
         }
+        return;
+    }
+
+    // Normal case: Each iteration of this for-loop paints one pixel
+    for (int i = 0; i < len; ++i)
+    {
+        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[i];
+
+        if (opacity != 0)
+            outBuf[i] = GetColor(t, opacity);
+
         t += _dtdx;
     }
 }
@@ -57,10 +57,14 @@ ShapeGen* CreateShapeGen(Renderer *renderer, const SGRect& cliprect)
 
 PathMgr::PathMgr(Renderer *renderer, const SGRect& cliprect) :
             _path(0), _edge(0), _pathlength(INITIAL_PATH_LENGTH),
+            _seglength(0), _seg(0),
             _angle(0), _fpoint(0), _cpoint(0), _figure(0), _figtmp(0),
             _dashoffset(0), _pdash(0), _dashlen(0), _dashon(true),
             _devicecliprect(cliprect), _fixshift(16),
-            _flatness(FLATNESS_DEFAULT), _fillrule(FILLRULE_DEFAULT),
+            _flatness(FLATNESS_DEFAULT), _flattenmode(FLATTENMODE_DEFAULT),
+            _cullmargin(-1), _simplify(0), _arcflat(0), _bXform(false),
+            _fillrule(FILLRULE_DEFAULT),
+            _cliptype(CLIPTYPE_DEFAULT), _bClipMask(false), _bSaveMask(false),
             _linewidth(LINEWIDTH_DEFAULT), _lineend(LINEEND_DEFAULT),
             _linejoin(LINEJOIN_DEFAULT), _miterlimit(MITERLIMIT_DEFAULT)
 {
@@ -92,7 +96,11 @@ PathMgr::PathMgr(Renderer *renderer, const SGRect& cliprect) :
     SetRenderer(renderer);
     InitClipRegion(cliprect.w, cliprect.h);
     SetFixedBits(0);
+    SetPathTransform(0);
     SetFlatness(FLATNESS_DEFAULT);
+    SetFlattenMode(FLATTENMODE_DEFAULT);
+    SetCullMargin(CULLMARGIN_DEFAULT);
+    SetSimplify(SIMPLIFY_DEFAULT);
     SetFillRule(FILLRULE_DEFAULT);
     SetLineWidth(LINEWIDTH_DEFAULT);
     SetLineEnd(LINEEND_DEFAULT);
@@ -106,6 +114,7 @@ PathMgr::~PathMgr()
 {
     delete _edge;
     delete[] _path;
+    delete[] _seg;
 }
 
 bool PathMgr::GetStatus()
@@ -125,6 +134,9 @@ bool PathMgr::SetRenderer(Renderer *renderer)
     if (_edge->SetRenderer(renderer) == false)
         return false;
 
+    // A clipping mask belongs to the old renderer, which frees it. The
+    // old renderer might already have been deleted, so don't touch it
+    _bClipMask = _bSaveMask = false;
     ResetClipRegion();  // N.B.: new renderer can change y resolution
     renderer->SetMaxWidth(_devicecliprect.w);
     renderer->SetScrollPosition(_devicecliprect.x, _devicecliprect.y);
@@ -146,6 +158,8 @@ void PathMgr::SetScrollPosition(int x, int y)
 {
     _devicecliprect.x = x;
     _devicecliprect.y = y;
+    _edge->SetCullRectangle(&_devicecliprect);
+    UpdateCullRect();
     _renderer->SetScrollPosition(x, y);  // to scroll fill patterns
 }
 
@@ -216,9 +230,192 @@ float PathMgr::SetFlatness(float tol)
     tol = max(tol, FLATNESS_MINIMUM);
     tol = min(tol, FLATNESS_MAXIMUM);
     _flatness = 65536*tol;  // convert to 16.16 fixed-point format
+    UpdateJoinHint();
     return oldtol;
 }
 
+//---------------------------------------------------------------------
+//
+// Public function: Selects the method used to flatten quadratic and
+// cubic Bezier curves. In FLATTENMODE_SUBDIVIDE mode, each curve is
+// recursively subdivided until each piece is flat enough. In
+// FLATTENMODE_UNIFORM mode, the number of line segments is calculated
+// up front from the control polygon, and the points are generated at
+// equal parameter steps. Both methods meet the tolerance set by the
+// SetFlatness function. Ellipses and elliptic arcs are not affected.
+// The function returns the previous setting.
+//
+//---------------------------------------------------------------------
+
+FLATTENMODE PathMgr::SetFlattenMode(FLATTENMODE mode)
+{
+    FLATTENMODE oldmode = _flattenmode;
+
+    switch (mode)
+    {
+    case FLATTENMODE_SUBDIVIDE:
+    case FLATTENMODE_UNIFORM:
+        _flattenmode = mode;
+        break;
+    default:
+        assert(0);
+        break;
+    }
+    return oldmode;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Enables or disables culling of off-screen curves.
+// If parameter margin is nonnegative, a curve (or a piece of a curve,
+// during subdivision) whose control polygon lies entirely outside the
+// device clipping rectangle, expanded by margin pixels on each side,
+// is added to the path as a single chord instead of being flattened.
+// The same test is applied to ellipses and elliptic arcs. Because the
+// curve and its chord both lie outside the rectangle on the same
+// side, the winding numbers inside the rectangle are not affected, so
+// filled shapes are drawn exactly as before. Before stroking a path,
+// set the margin to at least the distance that the stroke can extend
+// from the path (for example, half the line width times the miter
+// limit), and don't cull dashed lines: the chords change the dash
+// positions. Curves are flattened as they are added to the path, so
+// the margin must be set before the path is constructed. A negative
+// margin disables culling. The function returns the previous margin.
+//
+//---------------------------------------------------------------------
+
+float PathMgr::SetCullMargin(float margin)
+{
+    float oldmargin = (_cullmargin < 0) ? -1.0f : _cullmargin/65536.0f;
+
+    margin = min(margin, CULLMARGIN_MAXIMUM);
+    _cullmargin = (margin < 0) ? -1 : 65536*margin;
+    UpdateCullRect();
+    return oldmargin;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Updates the curve culling rectangle after the
+// device clipping rectangle, scroll position, or culling margin has
+// changed. The rectangle is in 16.16 fixed-point path coordinates.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::UpdateCullRect()
+{
+    _cullmin.x = (_devicecliprect.x << 16) - _cullmargin;
+    _cullmin.y = (_devicecliprect.y << 16) - _cullmargin;
+    _cullmax.x = ((_devicecliprect.x + _devicecliprect.w) << 16) + _cullmargin;
+    _cullmax.y = ((_devicecliprect.y + _devicecliprect.h) << 16) + _cullmargin;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Sets the tolerance used to simplify the figures in a
+// path. If parameter tol is greater than zero, each figure is reduced
+// to a subset of its points as the figure is finalized (by a
+// CloseFigure, EndFigure, Move, FillPath, or StrokePath call) so that
+// no discarded point lies farther than tol pixels from the simplified
+// figure. The tolerance never exceeds the current flatness setting, so
+// the simplified figure is no coarser than a flattened curve. Fewer
+// points mean fewer edges to fill and fewer joins to stroke. A zero
+// tolerance disables simplification. The function returns the previous
+// setting.
+//
+//---------------------------------------------------------------------
+
+float PathMgr::SetSimplify(float tol)
+{
+    float oldtol = _simplify/65536.0f;
+
+    tol = max(tol, 0);
+    tol = min(tol, SIMPLIFY_MAXIMUM);
+    _simplify = 65536*tol;  // convert to 16.16 fixed-point format
+    return oldtol;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Simplifies the figure whose points run from first
+// to last by using the Douglas-Peucker method. FinalizeFigure has
+// already removed the points that lie within half the tolerance of the
+// preceding kept point, so the remaining half is used here. The first and last
+// points are always kept. If the point farthest from the chord that
+// connects two kept points lies within the tolerance, the points
+// between them are discarded; otherwise, the farthest point is kept,
+// and each half is simplified in turn. The kept points are moved down
+// in the path array in their original order, and the function returns
+// a pointer to the new last point. If the split stack overflows, the
+// points in the affected span are all kept.
+//
+//---------------------------------------------------------------------
+
+VERT16* PathMgr::SimplifyFigure(VERT16 *first, VERT16 *last)
+{
+    float tol = min(_simplify, _flatness)/(2*65536.0f);
+    float tolsq = tol*tol;
+    VERT16 *stack[SIMPLIFY_MAXDEPTH];
+    VERT16 *out = first;  // last point kept so far
+    VERT16 *a = first;    // start of current chord
+    int top = 0;
+
+    stack[0] = last;
+    for (;;)
+    {
+        VERT16 *b = stack[top];  // end of current chord
+        VERT16 *vfar = 0;  // farthest point from chord
+        float dmax = tolsq;
+        float bx = (b->x - a->x)/65536.0f;
+        float by = (b->y - a->y)/65536.0f;
+        float lensq = bx*bx + by*by;
+        float rlensq = (lensq == 0) ? 0 : 1.0f/lensq;
+
+        // Find the point that lies farthest from the chord. Compare
+        // squared distances to the chord's line segment, not to the
+        // infinite line, so that a spike that doubles back along the
+        // chord isn't lost.
+        for (VERT16 *p = a + 1; p < b; ++p)
+        {
+            float px = (p->x - a->x)/65536.0f;
+            float py = (p->y - a->y)/65536.0f;
+            float t = px*bx + py*by;
+            float dsq;
+
+            if (t <= 0)
+                dsq = px*px + py*py;
+            else if (t >= lensq)
+                dsq = (px - bx)*(px - bx) + (py - by)*(py - by);
+            else
+            {
+                float cross = px*by - py*bx;
+                dsq = cross*cross*rlensq;
+            }
+            if (dsq > dmax)
+            {
+                dmax = dsq;
+                vfar = p;
+            }
+        }
+        if (vfar != 0 && top < SIMPLIFY_MAXDEPTH - 1)
+        {
+            stack[++top] = vfar;  // keep far point and split chord
+            continue;
+        }
+        if (vfar != 0)
+        {
+            for (VERT16 *p = a + 1; p < b; ++p)
+                *++out = *p;  // stack is full; keep every point
+        }
+        *++out = *b;
+        if (top-- == 0)
+            break;
+
+        a = b;
+    }
+    return out;
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Specifies the fixed-point representation to use for
@@ -241,9 +438,144 @@ int PathMgr::SetFixedBits(int nbits)
         return -1;
     }
     _fixshift = 16 - nbits;
+    if (_bXform)
+        SetPathTransform(_xform);  // rescale for new fixed-point format
+
     return oldnbits;
 }
 
+//---------------------------------------------------------------------
+//
+// Public function: Sets the affine transformation matrix to apply to
+// the x-y coordinates that the user supplies to ShapeGen interface
+// functions. Parameter xform is a 6-element matrix, defined as in the
+// SVG standard, that maps user coordinates to device coordinates.
+// Elements xform[4] and xform[5] are the x and y translations, in
+// pixels. Setting xform to 0 selects the identity matrix. Points are
+// transformed as they are added to the path, before curves and arcs
+// are flattened, so the flatness tolerance always applies in device
+// space, and a curve that is scaled up is flattened into as many
+// line segments as it needs. The transform does not affect the line
+// width or dash pattern for stroked paths, or the coordinates of the
+// clipping rectangle or scroll position. The coordinates returned by
+// GetCurrentPoint, GetFirstPoint, and GetBoundingBox are device
+// coordinates.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::SetPathTransform(const float xform[6])
+{
+    if (xform == 0 || (xform[0] == 1.0f && xform[1] == 0 &&
+                       xform[2] == 0 && xform[3] == 1.0f &&
+                       xform[4] == 0 && xform[5] == 0))
+    {
+        // Identity matrix. The floating-point path functions still
+        // use the _xform array, so load it with the identity matrix.
+        static const float ident[6] = { 1.0f, 0, 0, 1.0f, 0, 0 };
+
+        memcpy(_xform, ident, sizeof(_xform));
+        _bXform = false;
+        return;
+    }
+
+    // Fold the conversion from the user's fixed-point format to 16.16
+    // fixed-point into the matrix elements
+    float scale = static_cast<float>(1 << _fixshift);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        _xform[i] = xform[i];
+        _xfmat[i] = scale*xform[i];
+    }
+    _xform[4] = xform[4];
+    _xform[5] = xform[5];
+    _xfoff[0] = RoundFix(65536.0f*xform[4]);
+    _xfoff[1] = RoundFix(65536.0f*xform[5]);
+    _bXform = true;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Copies the current path transform to the 'xform'
+// array, so that the caller can restore it later by calling
+// SetPathTransform. Returns false, and leaves the array unchanged, if
+// the path transform is the identity matrix.
+//
+//---------------------------------------------------------------------
+
+bool PathMgr::GetPathTransform(float xform[6])
+{
+    if (_bXform == false)
+        return false;
+
+    memcpy(&xform[0], &_xform[0], sizeof(_xform));
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Converts an array of npts points in user
+// coordinates to transformed 16.16 fixed-point vertices. Parameter src
+// points to the user coordinates, and dst points to the array that
+// receives the vertices. Each loop below is free of branches and
+// member accesses, so the compiler can vectorize it.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::UserToDevice(VERT16 dst[], const SGPoint src[], int npts)
+{
+    if (_bXform == false)
+    {
+        int shift = _fixshift;
+
+        for (int i = 0; i < npts; ++i)
+        {
+            dst[i].x = src[i].x << shift;
+            dst[i].y = src[i].y << shift;
+        }
+        return;
+    }
+
+    float a = _xfmat[0], b = _xfmat[1];
+    float c = _xfmat[2], d = _xfmat[3];
+    FIX16 e = _xfoff[0], f = _xfoff[1];
+
+    for (int i = 0; i < npts; ++i)
+    {
+        float x = src[i].x, y = src[i].y;
+
+        dst[i].x = e + RoundFix(a*x + c*y);
+        dst[i].y = f + RoundFix(b*x + d*y);
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Converts an array of npts points in floating-point
+// user coordinates to transformed 16.16 fixed-point vertices. Array
+// src contains 2*npts elements: x0, y0, x1, y1, and so on. Parameter
+// dst points to the array that receives the vertices. Floating-point
+// coordinates are not affected by the SetFixedBits setting. The loop
+// handles the identity transform too, so it needs no branches.
+//
+//---------------------------------------------------------------------
+
+void PathMgr::FloatToDevice(VERT16 dst[], const float src[], int npts)
+{
+    float a = 65536.0f*_xform[0], b = 65536.0f*_xform[1];
+    float c = 65536.0f*_xform[2], d = 65536.0f*_xform[3];
+    FIX16 e = (_bXform) ? _xfoff[0] : 0;
+    FIX16 f = (_bXform) ? _xfoff[1] : 0;
+
+    for (int i = 0; i < npts; ++i)
+    {
+        float x = src[2*i], y = src[2*i+1];
+
+        dst[i].x = e + RoundFix(a*x + c*y);
+        dst[i].y = f + RoundFix(b*x + d*y);
+    }
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Begins a new path at the start of the allocated
@@ -279,20 +611,29 @@ void PathMgr::FinalizeFigure(bool bclose)
             int count = _cpoint - _fpoint;
             VERT16 *p = _fpoint, *q = p;
             FIX16 d, dx, dy;  // quick-and-dirty distance approx
+            FIX16 dmin = 255;
 
             // Before starting a new figure, remove any redundant
             // points from the current figure. When checking for
-            // matches, ignore small arithmetic precision errors
+            // matches, ignore small arithmetic precision errors. If
+            // the figure is to be simplified, also remove points that
+            // lie within half the tolerance of the last point kept
+            if (_simplify != 0)
+                dmin = max(dmin, min(_simplify, _flatness)/2);
+
             for (int i = 0; i < count; ++i)
             {
                 ++q;
                 dx = p->x - q->x;
                 dy = p->y - q->y;
                 d = (dx ^ (dx >> 31)) + (dy ^ (dy >> 31));
-                if ((d > 255) && ++p != q)
+                if ((d > dmin) && ++p != q)
                     *p = *q;  // keep this non-redundant point
             }
             _cpoint = p;
+            if (_simplify != 0 && _cpoint - _fpoint > 1)
+                _cpoint = SimplifyFigure(_fpoint, _cpoint);
+
             if (_cpoint != _fpoint)  // more than one point in figure?
             {
                 if (bclose)  // close this figure?
@@ -372,8 +713,7 @@ void PathMgr::Move(SGCoord x, SGCoord y)
 {
     EndFigure();
     _cpoint = _fpoint;
-    _cpoint->x = x << _fixshift;
-    _cpoint->y = y << _fixshift;
+    UserToDevice(_cpoint, x, y);
 }
 
 //---------------------------------------------------------------------
@@ -392,8 +732,7 @@ bool PathMgr::Line(SGCoord x, SGCoord y)
         return false;
     }
     PathCheck(++_cpoint);
-    _cpoint->x = x << _fixshift;
-    _cpoint->y = y << _fixshift;
+    UserToDevice(_cpoint, x, y);
     return true;
 }
 
@@ -415,12 +754,191 @@ bool PathMgr::PolyLine(const SGPoint xy[], int npts)
         assert(_cpoint != 0 && npts >= 0 && xy != 0);
         return false;
     }
-    for (int i = 0; i < npts; ++i)
+    // Make room for all npts points, and then convert them in a batch
+    while (&_cpoint[npts] >= &_path[_pathlength])
+        GrowPath();
+
+    UserToDevice(&_cpoint[1], xy, npts);
+    _cpoint += npts;
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Appends a polyline to the current figure, like the
+// PolyLine function, but first decimates the points. This function is
+// intended for plotting time series and other data in which many
+// consecutive points share the same x coordinate, at the resolution of
+// the display. A run of consecutive points that fall into the same
+// column is replaced by up to six points, in their original order: the
+// first point in the run, the first and last points with the minimum y
+// coordinate, the first and last points with the maximum y coordinate,
+// and the last point. (Keeping both ends of a run of points that are
+// tied for the minimum or maximum preserves the flat tops and bottoms
+// of clipped or saturated signals.) The columns are one pixel
+// wide, or 1/8 pixel wide if the renderer does antialiasing. Every
+// point that is removed lies inside the column and between the
+// minimum and maximum y coordinates, so the decimated polyline covers
+// the same y range in each column, and differs from the original
+// polyline by no more than the column width in x. The points are
+// processed in a single pass, in small batches, so the original
+// polyline is never stored in the path. The input doesn't have to be
+// x-monotone, but a monotone polyline produces the fewest points.
+//
+//----------------------------------------------------------------------
+
+bool PathMgr::PolyLineDecimated(const SGPoint xy[], int npts)
+{
+    if (_cpoint == 0 || npts < 0 || xy == 0)
+    {
+        assert(_cpoint != 0 && npts >= 0 && xy != 0);
+        return false;
+    }
+
+    const int BATCHLEN = 64;
+    VERT16 v[BATCHLEN];
+    int shift = (_renderer->QueryYResolution() == 0) ? 16 : 13;
+    int col = _cpoint->x >> shift;  // current column
+
+    // For the points in the current column, vert[0] and vert[1] are
+    // the first and last points with the minimum y, vert[2] and vert[3]
+    // are the first and last points with the maximum y, and vert[4] is
+    // the last point. Array index has their positions in the column
+    // (the first point in the column is at position 0, and is already
+    // in the path).
+    VERT16 vert[5];
+    int index[5];
+    int count = 0;
+
+    for (int k = 0; k < 5; ++k)
+        vert[k] = *_cpoint, index[k] = 0;
+
+    for (int i = 0; i < npts; i += BATCHLEN)
+    {
+        int len = min(BATCHLEN, npts - i);
+
+        UserToDevice(v, &xy[i], len);
+        for (int j = 0; j < len; ++j)
+        {
+            if ((v[j].x >> shift) != col)
+            {
+                // Finish the current column, and start a new one
+                AppendColumn(vert, index);
+                PathCheck(++_cpoint);
+                *_cpoint = v[j];
+                col = v[j].x >> shift;
+                for (int k = 0; k < 5; ++k)
+                    vert[k] = v[j], index[k] = 0;
+
+                count = 0;
+                continue;
+            }
+            ++count;
+            if (v[j].y < vert[0].y)
+                vert[0] = vert[1] = v[j], index[0] = index[1] = count;
+            else if (v[j].y == vert[0].y)
+                vert[1] = v[j], index[1] = count;
+
+            if (v[j].y > vert[2].y)
+                vert[2] = vert[3] = v[j], index[2] = index[3] = count;
+            else if (v[j].y == vert[2].y)
+                vert[3] = v[j], index[3] = count;
+
+            vert[4] = v[j], index[4] = count;
+        }
+    }
+    AppendColumn(vert, index);
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Called by PolyLineDecimated to append the points
+// that remain in a column after decimation. Arrays vert and index
+// contain the five points described in PolyLineDecimated and their
+// positions in the column. The first point in the column (at position
+// 0) is already in the path. The points are appended in order of
+// increasing position, and each point is appended only once.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::AppendColumn(const VERT16 vert[5], const int index[5])
+{
+    int last = 0;  // position of last point appended
+
+    for (;;)
     {
+        // Find the point with the next higher position
+        int k = -1;
+        for (int i = 0; i < 5; ++i)
+        {
+            if (index[i] > last && (k < 0 || index[i] < index[k]))
+                k = i;
+        }
+        if (k < 0)
+            break;
+
         PathCheck(++_cpoint);
-        _cpoint->x = xy[i].x << _fixshift;
-        _cpoint->y = xy[i].y << _fixshift;
+        *_cpoint = vert[k];
+        last = index[k];
     }
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Appends a series of connected line segments to the
+// current figure, like the PolyLine function, but the points are
+// specified as floating-point user coordinates. Array xy contains
+// 2*npts elements: x0, y0, x1, y1, and so on. The points are converted
+// in a single pass directly into the path memory.
+//
+//----------------------------------------------------------------------
+
+bool PathMgr::PolyLineF(const float xy[], int npts)
+{
+    if (_cpoint == 0 || npts < 0 || xy == 0)
+    {
+        assert(_cpoint != 0 && npts >= 0 && xy != 0);
+        return false;
+    }
+    while (&_cpoint[npts] >= &_path[_pathlength])
+        GrowPath();
+
+    FloatToDevice(&_cpoint[1], xy, npts);
+    _cpoint += npts;
+    return true;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Adds a figure constructed from connected cubic
+// Bezier curves to the current path. Array xy contains the points in
+// floating-point user coordinates, and is laid out in the same way as
+// the pts array in a nanosvg NSVGpath structure: the first point is
+// the starting point of the figure, and each of the following groups
+// of three points defines another curve. Array xy contains 2*npts
+// elements: x0, y0, x1, y1, and so on. Parameter bclosed is true if
+// the figure is closed. Before constructing the figure, the function
+// finalizes any previous figure in the current path. On return, the
+// current point is the last point in the figure if the figure is
+// open, or is undefined if the figure is closed.
+//
+//----------------------------------------------------------------------
+
+bool PathMgr::BezierFigureF(const float xy[], int npts, bool bclosed)
+{
+    if (npts < 1 || xy == 0)
+    {
+        assert(npts > 0 && xy != 0);
+        return false;
+    }
+    EndFigure();
+    _cpoint = _fpoint;
+    FloatToDevice(_cpoint, xy, 1);
+    PolyBezier3F(&xy[2], npts - 1);
+    if (bclosed)
+        CloseFigure();
+
     return true;
 }
 
@@ -487,13 +1005,7 @@ bool PathMgr::FilledShape()
             --nverts;
         }
         if (vs != ve)
-        {
-            for (int i = 0; i < nverts; i++)
-            {
-                _edge->AttachEdge(vs, ve);
-                vs = ve++;
-            }
-        }
+            _edge->AttachEdges(ve, nverts, true);
     }
     return true;
 }
@@ -539,6 +1051,57 @@ bool PathMgr::FillPath()
     return _edge->FillEdgeList();
 }
 
+//---------------------------------------------------------------------
+//
+// Public function: Fills the n rectangles in the rects array. Each
+// rectangle is filled as though it were the only figure in a path
+// built by the Rectangle function and filled by FillPath, so that
+// overlapping translucent rectangles are blended more than once. The
+// current path is not affected. If the path transform doesn't rotate
+// or skew the rectangles, and the clipping region is a rectangle,
+// each rectangle is handed to the renderer in a single call, without
+// any edge processing. The renderer then fills the interior of the
+// rectangle directly and computes coverage for only the border pixels.
+//
+//----------------------------------------------------------------------
+
+void PathMgr::FillRects(const SGRect rects[], int n)
+{
+    bool baligned = (!_bXform || (_xfmat[1] == 0 && _xfmat[2] == 0));
+    FIX16 xscroll = _devicecliprect.x << 16;
+    FIX16 yscroll = _devicecliprect.y << 16;
+
+    assert(rects != 0 || n == 0);
+    for (int i = 0; i < n; ++i)
+    {
+        const SGRect& rect = rects[i];
+        VERT16 v[4];
+
+        UserToDevice(&v[0], rect.x, rect.y);
+        UserToDevice(&v[1], rect.x + rect.w, rect.y);
+        UserToDevice(&v[2], rect.x + rect.w, rect.y + rect.h);
+        UserToDevice(&v[3], rect.x, rect.y + rect.h);
+        if (baligned)
+        {
+            VERT16 vmin, vmax;  // corners in device coordinates
+
+            vmin.x = min(v[0].x, v[2].x) - xscroll;
+            vmin.y = min(v[0].y, v[2].y) - yscroll;
+            vmax.x = max(v[0].x, v[2].x) - xscroll;
+            vmax.y = max(v[0].y, v[2].y) - yscroll;
+            if (_edge->FillRectangle(&vmin, &vmax))
+                continue;
+        }
+        _edge->AttachEdges(v, 4, true);
+        if ((_devicecliprect.x | _devicecliprect.y) != 0)
+            _edge->TranslateEdges(_devicecliprect.x, _devicecliprect.y);
+
+        _edge->NormalizeEdges(_fillrule);
+        _edge->ClipEdges(FILLRULE_INTERSECT);
+        _edge->FillEdgeList();
+    }
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Strokes the current path
@@ -559,6 +1122,27 @@ bool PathMgr::StrokePath()
     return _edge->FillEdgeList();
 }
 
+//---------------------------------------------------------------------
+//
+// Private function: Decides whether the clipping region that is to be
+// set from the normalized edge list should be rasterized to the
+// renderer's coverage mask instead of being kept as an edge list. In
+// CLIPTYPE_AUTO mode, only a very complex region is rasterized.
+//
+//---------------------------------------------------------------------
+
+bool PathMgr::UseClipMask()
+{
+    if (_cliptype == CLIPTYPE_EDGES || _renderer->QueryClipMask() == false)
+        return false;
+
+    int count = _edge->CountEdges();
+    if (count == 0)
+        return false;  // new clipping region is empty
+
+    return (_cliptype == CLIPTYPE_MASK || count >= CLIPMASK_MIN_EDGES);
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Sets the new clipping region to the intersection
@@ -592,6 +1176,17 @@ bool PathMgr::SetClipRegion(CLIPMODE clipmode)
         _edge->TranslateEdges(_devicecliprect.x, _devicecliprect.y);
 
     _edge->NormalizeEdges(rule);
+    if (UseClipMask())
+    {
+        // Intersect the clipping mask with the clipped path. The mask
+        // now describes the entire clipping region, so the clip list
+        // reverts to the device clipping rectangle.
+        _edge->ClipEdges(FILLRULE_INTERSECT);
+        _bClipMask = true;
+        bool status = _edge->SetClipMask(CLIPMASK_INTERSECT);
+        _edge->SetDeviceClipRectangle(_devicecliprect.w, _devicecliprect.h, true);
+        return status;
+    }
     _edge->ClipEdges(FILLRULE_INTERSECT);
     return _edge->SetClipList();
 }
@@ -629,6 +1224,14 @@ bool PathMgr::SetMaskRegion(CLIPMODE clipmode)
         _edge->TranslateEdges(_devicecliprect.x, _devicecliprect.y);
 
     _edge->NormalizeEdges(rule);
+    if (UseClipMask())
+    {
+        // Mask off the part of the path inside the current clip list
+        _edge->ClipEdges(FILLRULE_INTERSECT);
+        _bClipMask = true;
+        return _edge->SetClipMask(CLIPMASK_EXCLUDE) &&
+               _edge->_cliplist.head != 0;
+    }
     _edge->ReverseEdges();
     _edge->ClipEdges(FILLRULE_EXCLUDE);
     return _edge->SetClipList();
@@ -644,6 +1247,11 @@ bool PathMgr::SetMaskRegion(CLIPMODE clipmode)
 void PathMgr::ResetClipRegion()
 {
     _edge->SetDeviceClipRectangle(_devicecliprect.w, _devicecliprect.h, true);
+    if (_bClipMask)
+    {
+        _renderer->UpdateClipMask(CLIPMASK_RESET);
+        _bClipMask = false;
+    }
 }
 
 //---------------------------------------------------------------------
@@ -664,10 +1272,90 @@ bool PathMgr::InitClipRegion(int width, int height)
     _devicecliprect.w = width;
     _devicecliprect.h = height;
     _edge->SetDeviceClipRectangle(width, height, false);
+    _edge->SetCullRectangle(&_devicecliprect);
+    UpdateCullRect();
+    if (_bClipMask || _bSaveMask)
+    {
+        _renderer->UpdateClipMask(CLIPMASK_INIT);
+        _bClipMask = _bSaveMask = false;
+    }
     _renderer->SetMaxWidth(width);
     return true;
 }
 
+//---------------------------------------------------------------------
+//
+// Public function: Saves a copy of the current clipping region, which
+// can later be restored by calling SwapClipRegion. If the renderer
+// has a clipping mask, the mask is saved along with the clip list.
+// Returns true if the current clipping region is not empty.
+//
+//---------------------------------------------------------------------
+
+bool PathMgr::SaveClipRegion()
+{
+    bool status = _edge->SaveClipRegion();
+
+    if (_bClipMask || _bSaveMask)
+    {
+        status = _renderer->UpdateClipMask(CLIPMASK_SAVE) && status;
+        _bSaveMask = _bClipMask;
+    }
+    return status;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Swaps the current clipping region with the copy
+// that was previously saved by SaveClipRegion (or swapped out by an
+// earlier SwapClipRegion call). Returns true if the new clipping
+// region is not empty.
+//
+//---------------------------------------------------------------------
+
+bool PathMgr::SwapClipRegion()
+{
+    bool status = _edge->SwapClipRegion();
+
+    if (_bClipMask || _bSaveMask)
+    {
+        status = _renderer->UpdateClipMask(CLIPMASK_SWAP) && status;
+        bool swap = _bClipMask;  _bClipMask = _bSaveMask;  _bSaveMask = swap;
+    }
+    return status;
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Selects how subsequent SetClipRegion and
+// SetMaskRegion calls represent the clipping region: as a list of
+// polygonal edges, or as an antialiased coverage mask stored by the
+// renderer. In CLIPTYPE_AUTO mode, the coverage mask is used only if
+// the path has CLIPMASK_MIN_EDGES or more edges. If the renderer
+// doesn't support clipping masks, the edge list is always used. The
+// current clipping region is not affected. The function returns the
+// previous setting.
+//
+//---------------------------------------------------------------------
+
+CLIPTYPE PathMgr::SetClipType(CLIPTYPE cliptype)
+{
+    CLIPTYPE oldtype = _cliptype;
+
+    switch (cliptype)
+    {
+    case CLIPTYPE_AUTO:
+    case CLIPTYPE_EDGES:
+    case CLIPTYPE_MASK:
+        _cliptype = cliptype;
+        break;
+    default:
+        assert(0);
+        break;
+    }
+    return oldtype;
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Retrieves the current point. If the current point
@@ -26,6 +26,8 @@
 //
 //---------------------------------------------------------------------
 
+#include <stdlib.h>
+#include <math.h>
 #include <string.h>
 #include <assert.h>
 #include "renderer.h"
@@ -114,6 +116,14 @@ namespace {
         return (x < 0) ? x + n : x;
     }
 
+    // Returns the value x modulo n. If n is a power of two, parameter
+    // 'mask' is n-1, and the modulus is obtained by masking off the
+    // high-order bits of x. Otherwise, 'mask' is -1.
+    inline int wrap(int x, int n, int mask)
+    {
+        return (mask >= 0) ? (x & mask) : modulus(x, n);
+    }
+
     // A 4-pixel multisampling pattern for antialiasing. Each offset
     // value is in units of 1/8th of a pixel from the pixel center.
     const XYPAIR msaa4x4[4][4] = {
@@ -122,6 +132,464 @@ namespace {
         { { -2, -3 }, { +3, -2 }, { +2, +3 }, { -3, +2 } },  // x even, y odd
         { { -3, -2 }, { +2, -3 }, { +3, +2 }, { -2, +3 } },  // x odd,  y odd
     };
+
+    // Sets up the matrix 'uvxform' for the affine transformation from
+    // the viewport's x-y pixel coordinates to a pattern's u-v texel
+    // coordinates. The texel at (u0,v0) maps to the origin. If 'xform'
+    // is null, the pattern is not transformed.
+    void SetPatternXform(float uvxform[6], const float xform[6],
+                         float u0, float v0, int flags)
+    {
+        if (xform != 0)
+            memcpy(&uvxform[0], &xform[0], 6*sizeof(uvxform[0]));
+        else
+        {
+            memset(&uvxform[0], 0, 6*sizeof(uvxform[0]));
+            uvxform[0] = uvxform[3] = 1.0f;
+        }
+        if (flags & FLAG_IMAGE_BOTTOMUP)
+        {
+            // Rows of bitmap image are ordered bottom-to-top
+            uvxform[1] = -uvxform[1];
+            uvxform[3] = -uvxform[3];
+        }
+        uvxform[4] += (uvxform[0]+uvxform[2])/2 - u0;
+        uvxform[5] += (uvxform[1]+uvxform[3])/2 - v0;
+    }
+
+    // For each display pixel in the four-pixel multisampling pattern,
+    // calculates the corresponding four u-v sampling offsets from the
+    // center of the corresponding pattern texel. The partial
+    // derivatives of u and v are in 16.16 fixed-point format. Also
+    // gets the max magnitudes of the u and v offsets.
+    void SetSampleOffsets(UVPAIR offset[4][4], FIX16 dudx, FIX16 dvdx,
+                          FIX16 dudy, FIX16 dvdy, FIX16 *maxoffu, FIX16 *maxoffv)
+    {
+        *maxoffu = *maxoffv = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const XYPAIR *p = msaa4x4[i];
+            UVPAIR *q = offset[i];
+
+            for (int j = 0; j < 4; ++j)
+            {
+                q[j].u = (dudx*p[j].x + dudy*p[j].y)/8;
+                q[j].v = (dvdx*p[j].x + dvdy*p[j].y)/8;
+                *maxoffu = max(*maxoffu, abs(q[j].u));
+                *maxoffv = max(*maxoffv, abs(q[j].v));
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Pattern image store -- Keeps decoded pattern images in the renderer's
+// internal pixel format (premultiplied-alpha BGRA) so that any number
+// of Pattern objects can share an image without copying it. An image
+// from a named source (see ImageReader::GetImageName) stays in the
+// store after its last user releases it, so the source needs to be
+// decoded only once. A stored image is reused only if the source's
+// modification time and size (see ImageReader::GetImageStamp) are
+// unchanged. Unused images are discarded, least recently used first,
+// when the store's total memory exceeds a specified limit. Every image
+// is reference-counted, and the store holds one reference to each
+// image in it, so an image is freed only after both the store and
+// the last Pattern object using the image have released it. The store
+// never frees an image when the program exits.
+//
+//---------------------------------------------------------------------
+
+namespace {
+    // Default limit on memory used by pattern images, in bytes
+    const int IMAGE_STORE_DEFAULT_LIMIT = 32*1024*1024;
+
+    // Flags that affect the stored texel values of a pattern image
+    const int IMAGE_FORMAT_FLAGS = FLAG_SWAP_REDBLUE | FLAG_PREMULTALPHA;
+
+    // A pattern image (or one level in its mipmap chain) that is
+    // surrounded by a border one texel wide. The border contains
+    // copies of the texels that wrap around from the opposite edges
+    // of the image.
+    struct TEXTURE
+    {
+        COLOR *pixels;    // image plus 1-texel border
+        COLOR **rows;     // pointers to rows of padded image
+        COLOR **texel;    // texel[-1..h][-1..w] = padded image
+        int w, h;         // width and height of image
+        TEXTURE *next;    // next smaller level in mipmap chain
+    };
+
+    // Allocates a w-by-h texture. Returns a null pointer if there
+    // is not enough memory.
+    TEXTURE* AllocTexture(int w, int h)
+    {
+        int stride = w + 2;
+        TEXTURE *tex = new TEXTURE;
+
+        if (tex == 0)
+        {
+            assert(tex);
+            return 0;  // fail - out of memory
+        }
+        tex->pixels = new COLOR[stride*(h + 2)];
+        tex->rows = new COLOR*[h + 2];  // pointers to rows of pattern
+        if (tex->pixels == 0 || tex->rows == 0)
+        {
+            assert(tex->pixels != 0 && tex->rows != 0);
+            delete[] tex->pixels;
+            delete[] tex->rows;
+            delete tex;
+            return 0;  // fail - out of memory
+        }
+        for (int j = 0; j < h + 2; ++j)
+            tex->rows[j] = &tex->pixels[j*stride + 1];
+
+        tex->texel = &tex->rows[1];
+        tex->w = w, tex->h = h;
+        tex->next = 0;
+        return tex;
+    }
+
+    // Frees a texture and all the smaller levels in its mipmap chain
+    void FreeTexture(TEXTURE *tex)
+    {
+        while (tex != 0)
+        {
+            TEXTURE *next = tex->next;
+
+            delete[] tex->pixels;
+            delete[] tex->rows;
+            delete tex;
+            tex = next;
+        }
+    }
+
+    // Returns the number of bytes of memory used by a texture
+    int TextureSize(const TEXTURE *tex)
+    {
+        return (tex->w + 2)*(tex->h + 2)*sizeof(COLOR) +
+               (tex->h + 2)*sizeof(COLOR*) + sizeof(TEXTURE);
+    }
+
+    // Fills in the border around the image with texels that wrap
+    // around from the opposite edges, so that the multisampling
+    // loop in FillSpan can fetch them without doing modulo math
+    void FillBorder(TEXTURE *tex)
+    {
+        COLOR **texel = tex->texel;
+        int w = tex->w, h = tex->h;
+
+        for (int j = 0; j < h; ++j)
+        {
+            texel[j][-1] = texel[j][w-1];
+            texel[j][w] = texel[j][0];
+        }
+        memcpy(&texel[-1][-1], &texel[h-1][-1], (w+2)*sizeof(COLOR));
+        memcpy(&texel[h][-1], &texel[0][-1], (w+2)*sizeof(COLOR));
+    }
+
+    // Converts the texels in a newly loaded texture to premultiplied-
+    // alpha BGRA format, and fills in the texture's border
+    void ConvertTexels(TEXTURE *tex, int flags)
+    {
+        // Do we need to convert from RGBA (0xaabbggrr) to BGRA (0xaarrggbb),
+        // or vice versa? If so, swap the red and blue fields.
+        if (flags & FLAG_SWAP_REDBLUE)
+        {
+            for (int j = 0; j < tex->h; ++j)
+            {
+                COLOR *p = tex->texel[j];
+                for (int i = 0; i < tex->w; ++i)
+                {
+                    COLOR rgba = *p, rb = rgba & 0x00ff00ff;
+                    *p++ = (rgba ^ rb) | (rb << 16) | (rb >> 16);
+                }
+            }
+        }
+
+        // If the pattern texels are not already in premultiplied-
+        // alpha format, convert them now...
+        if (~flags & FLAG_PREMULTALPHA)
+        {
+            for (int j = 0; j < tex->h; ++j)
+                PremultAlphaArray(tex->texel[j], tex->w);
+        }
+        FillBorder(tex);
+    }
+
+    // Creates the next smaller level in a texture's mipmap chain. Each
+    // dimension is halved (but not below 1), and each new texel is the
+    // box-filtered average of the 2 to 3 texels in each dimension that
+    // it replaces. Because the texels are premultiplied, they can be
+    // averaged directly. Returns a null pointer if out of memory.
+    TEXTURE* ShrinkTexture(const TEXTURE *src)
+    {
+        int w = max(src->w/2, 1), h = max(src->h/2, 1);
+        TEXTURE *tex = AllocTexture(w, h);
+
+        if (tex == 0)
+            return 0;  // fail - out of memory
+
+        for (int j = 0; j < h; ++j)
+        {
+            int j0 = j*src->h/h, j1 = (j + 1)*src->h/h;
+
+            for (int i = 0; i < w; ++i)
+            {
+                int i0 = i*src->w/w, i1 = (i + 1)*src->w/w;
+                int count = (i1 - i0)*(j1 - j0);
+                COLOR sum[4] = { 0, 0, 0, 0 };
+
+                for (int y = j0; y < j1; ++y)
+                {
+                    for (int x = i0; x < i1; ++x)
+                    {
+                        COLOR texel = src->texel[y][x];
+
+                        sum[0] += texel & 0xff;
+                        sum[1] += (texel >> 8) & 0xff;
+                        sum[2] += (texel >> 16) & 0xff;
+                        sum[3] += texel >> 24;
+                    }
+                }
+                COLOR color = 0;
+                for (int n = 3; n >= 0; --n)
+                    color = (color << 8) | ((sum[n] + count/2)/count);
+
+                tex->texel[j][i] = color;
+            }
+        }
+        FillBorder(tex);
+        return tex;
+    }
+
+    // A reference-counted pattern image
+    struct IMAGE
+    {
+        char *name;       // name of image source (null if not in store)
+        long mtime;       // modification time of image source
+        long fsize;       // size of image source
+        int flags;        // format flags (IMAGE_FORMAT_FLAGS)
+        int refcount;     // number of Pattern objects (and store) using image
+        int nbytes;       // memory used by all mipmap levels
+        TEXTURE *tex;     // full-size image (mipmap level 0)
+        IMAGE *prev;      // next more recently used image in store
+        IMAGE *next;      // next less recently used image in store
+    };
+
+    class ImageStore
+    {
+        IMAGE *_head;     // most recently used image
+        IMAGE *_tail;     // least recently used image
+        int _nbytes;      // memory used by images in store
+        int _maxbytes;    // memory limit for images in store
+
+        void Unlink(IMAGE *img);
+        void RemoveImage(IMAGE *img);
+        void Trim();
+
+    public:
+        // N.B.: No destructor. Images that are in use when the
+        // program exits must not be freed out from under their users.
+        ImageStore() : _head(0), _tail(0), _nbytes(0),
+                       _maxbytes(IMAGE_STORE_DEFAULT_LIMIT)
+        {
+        }
+        IMAGE* NewImage(int w, int h, int flags);
+        IMAGE* FindImage(const char *name, long mtime, long fsize,
+                         int w, int h, int flags);
+        void AddImage(IMAGE *img, const char *name, long mtime, long fsize);
+        void ReleaseImage(IMAGE *img);
+        TEXTURE* GetNextLevel(IMAGE *img, TEXTURE *tex);
+        void SetLimit(int maxbytes);
+    };
+
+    // Removes an image from the store's LRU list
+    void ImageStore::Unlink(IMAGE *img)
+    {
+        if (img->prev)
+            img->prev->next = img->next;
+        else
+            _head = img->next;
+
+        if (img->next)
+            img->next->prev = img->prev;
+        else
+            _tail = img->prev;
+
+        img->prev = img->next = 0;
+        _nbytes -= img->nbytes;
+    }
+
+    // Removes an image from the store, and releases the store's
+    // reference to the image. The image is freed only if no Pattern
+    // object is still using it.
+    void ImageStore::RemoveImage(IMAGE *img)
+    {
+        Unlink(img);
+        delete[] img->name;
+        img->name = 0;  // image is no longer in store
+        ReleaseImage(img);
+    }
+
+    // Discards unused images, least recently used first, until the
+    // memory used by the store falls within the specified limit
+    void ImageStore::Trim()
+    {
+        IMAGE *img = _tail;
+
+        while (img != 0 && _nbytes > _maxbytes)
+        {
+            IMAGE *prev = img->prev;
+
+            if (img->refcount == 1)  // only the store uses image?
+                RemoveImage(img);
+
+            img = prev;
+        }
+    }
+
+    // Creates a new image that isn't in the store and has a reference
+    // count of 1. The caller loads the texels and then calls
+    // ConvertTexels.
+    IMAGE* ImageStore::NewImage(int w, int h, int flags)
+    {
+        IMAGE *img = new IMAGE;
+
+        if (img == 0)
+        {
+            assert(img);
+            return 0;  // fail - out of memory
+        }
+        img->tex = AllocTexture(w, h);
+        if (img->tex == 0)
+        {
+            delete img;
+            return 0;  // fail - out of memory
+        }
+        img->name = 0;
+        img->mtime = img->fsize = 0;
+        img->flags = flags & IMAGE_FORMAT_FLAGS;
+        img->refcount = 1;
+        img->nbytes = TextureSize(img->tex);
+        img->prev = img->next = 0;
+        return img;
+    }
+
+    // Looks for a stored image that was decoded from the named source
+    // with the same dimensions and format. If one is found, and the
+    // source's modification time and size are unchanged, the image
+    // becomes the most recently used image, and its reference count is
+    // incremented. If the source has changed since the image was
+    // decoded, the out-of-date image is removed from the store.
+    // Otherwise, the function returns a null pointer.
+    IMAGE* ImageStore::FindImage(const char *name, long mtime, long fsize,
+                                 int w, int h, int flags)
+    {
+        flags &= IMAGE_FORMAT_FLAGS;
+        for (IMAGE *img = _head; img != 0; img = img->next)
+        {
+            if (img->tex->w == w && img->tex->h == h &&
+                img->flags == flags && strcmp(img->name, name) == 0)
+            {
+                if (img->mtime != mtime || img->fsize != fsize)
+                {
+                    RemoveImage(img);  // source has changed
+                    return 0;
+                }
+
+                int nbytes = img->nbytes;
+
+                Unlink(img);
+                img->next = _head;
+                if (_head)
+                    _head->prev = img;
+                else
+                    _tail = img;
+
+                _head = img;
+                _nbytes += nbytes;
+                ++img->refcount;
+                return img;
+            }
+        }
+        return 0;
+    }
+
+    // Adds a newly created image to the store under the specified
+    // source name, modification time and size, and makes it the most
+    // recently used image. The store takes its own reference to the
+    // image, so the image stays in the store after the caller
+    // releases it.
+    void ImageStore::AddImage(IMAGE *img, const char *name, long mtime, long fsize)
+    {
+        assert(img->name == 0 && img->prev == 0 && img->next == 0);
+        img->name = new char[strlen(name) + 1];
+        if (img->name == 0)
+        {
+            assert(img->name);
+            return;  // out of memory - image won't be shared
+        }
+        strcpy(img->name, name);
+        img->mtime = mtime;
+        img->fsize = fsize;
+        ++img->refcount;  // store's reference
+        img->next = _head;
+        if (_head)
+            _head->prev = img;
+        else
+            _tail = img;
+
+        _head = img;
+        _nbytes += img->nbytes;
+        Trim();
+    }
+
+    // Decrements an image's reference count, and frees the image when
+    // its count reaches zero. If only the store's reference remains,
+    // the image stays in the store until it is discarded to make room
+    // for other images.
+    void ImageStore::ReleaseImage(IMAGE *img)
+    {
+        assert(img->refcount > 0);
+        if (--img->refcount == 0)
+        {
+            assert(img->name == 0);  // not in store
+            FreeTexture(img->tex);
+            delete img;
+        }
+        else if (img->refcount == 1 && img->name != 0)
+            Trim();
+    }
+
+    // Returns the next smaller mipmap level after texture 'tex' in the
+    // specified image's mipmap chain. The level is created the first
+    // time it is needed, and is then shared by all users of the image.
+    // Returns a null pointer if there is not enough memory.
+    TEXTURE* ImageStore::GetNextLevel(IMAGE *img, TEXTURE *tex)
+    {
+        if (tex->next == 0)
+        {
+            tex->next = ShrinkTexture(tex);
+            if (tex->next == 0)
+                return 0;  // fail - out of memory
+
+            int nbytes = TextureSize(tex->next);
+            img->nbytes += nbytes;
+            if (img->name != 0)
+                _nbytes += nbytes;  // image is in store's LRU list
+        }
+        return tex->next;
+    }
+
+    void ImageStore::SetLimit(int maxbytes)
+    {
+        _maxbytes = max(maxbytes, 0);
+        Trim();
+    }
+
+    ImageStore store;  // shared by all Pattern objects
 }
 
 //---------------------------------------------------------------------
@@ -132,21 +600,27 @@ namespace {
 
 class Pattern : public TiledPattern
 {
-    COLOR **_pattern;     // stored pattern image
-    int _w, _h;           // width and height of image
+    IMAGE *_image;        // shared pattern image
+    COLOR **_pattern;     // texels at selected mipmap level
+    int _w, _h;           // width and height of selected level
+    int _wmask, _hmask;   // w-1 and h-1 if power of two; else -1
     float _xform[6];      // affine transformation matrix
     FIX16 _dudx;          // partial derivative du/dx
     FIX16 _dvdx;          // partial derivative dv/dx
     FIX16 _dudy;          // partial derivative du/dy
     FIX16 _dvdy;          // partial derivative dv/dy
     UVPAIR _offset[4][4]; // multisampling offsets for antialiasing
+    FIX16 _maxoffu;       // max magnitude of u sampling offsets
+    FIX16 _maxoffv;       // max magnitude of v sampling offsets
+    bool _bInBorder;      // all samples stay inside 1-texel border
     int _xscroll, _yscroll; // scroll position coordinates
 
     // Initialization code common to both constructors
     void Init(float u0, float v0, int flags, const float xform[6]);
+    void FillNearest(FIX16 u, FIX16 v, int len, COLOR outBuf[], const COLOR inAlpha[]);
 
 public:
-    Pattern() : _w(0), _h(0)
+    Pattern() : _image(0), _w(0), _h(0)
     {
         assert(0);
     }
@@ -163,108 +637,90 @@ public:
 // Contains initialization code common to both constructors
 void Pattern::Init(float u0, float v0, int flags, const float xform[6])
 {
-    // Do we need to convert from RGBA (0xaabbggrr) to BGRA (0xaarrggbb),
-    // or vice versa? If so, swap the red and blue fields.
-    if (flags & FLAG_SWAP_REDBLUE)
-    {
-        for (int j = 0; j < _h; ++j)
-        {
-            COLOR *p = _pattern[j];
-            for (int i = 0; i < _w; ++i)
-            {
-                COLOR rgba = *p, rb = rgba & 0x00ff00ff;
-                *p++ = (rgba ^ rb) | (rb << 16) | (rb >> 16);
-            }
-        }
-    }
-
-    // If the pattern texels are not already in premultiplied-
-    // alpha format, convert them now...
-    if (~flags & FLAG_PREMULTALPHA)
-        PremultAlphaArray(_pattern[0], _w*_h);
+    TEXTURE *tex = _image->tex;
 
     // Set up matrix for affine transformation from viewport's
     // x-y pixel coordinates to pattern's u-v texel coordinates
-    if (xform != 0)
-        memcpy(&_xform[0], &xform[0], sizeof(_xform));
-    else
-    {
-        memset(&_xform[0], 0, sizeof(_xform));
-        _xform[0] = _xform[3] = 1.0f;
-    }
-    if (flags & FLAG_IMAGE_BOTTOMUP)
+    SetPatternXform(_xform, xform, u0, v0, flags);
+
+    // If the transform shrinks the pattern so much that the pixel
+    // footprint spans two or more texels, the four samples per pixel
+    // are too sparse and the pattern aliases. Step down the mipmap
+    // chain until the footprint at the current level spans fewer
+    // than two texels.
+    for (;;)
     {
-        // Rows of bitmap image are ordered bottom-to-top
-        _xform[1] = -_xform[1];
-        _xform[3] = -_xform[3];
+        float xlen = sqrt(_xform[0]*_xform[0] + _xform[1]*_xform[1]);
+        float ylen = sqrt(_xform[2]*_xform[2] + _xform[3]*_xform[3]);
+
+        if (max(xlen, ylen) < 2.0f || (tex->w == 1 && tex->h == 1))
+            break;
+
+        TEXTURE *next = store.GetNextLevel(_image, tex);
+        if (next == 0)
+            break;
+
+        // Rescale u and v to texel coordinates at the new level
+        float su = float(next->w)/tex->w, sv = float(next->h)/tex->h;
+        _xform[0] *= su, _xform[2] *= su, _xform[4] *= su;
+        _xform[1] *= sv, _xform[3] *= sv, _xform[5] *= sv;
+        tex = next;
     }
-    _xform[4] += (_xform[0]+_xform[2])/2 - u0;
-    _xform[5] += (_xform[1]+_xform[3])/2 - v0;
+    _pattern = tex->texel;
+    _w = tex->w, _h = tex->h;  // mark pattern as valid
+    _wmask = (_w & (_w - 1)) ? -1 : _w - 1;
+    _hmask = (_h & (_h - 1)) ? -1 : _h - 1;
+
     _dudx = 65536*_xform[0];
     _dvdx = 65536*_xform[1];
     _dudy = 65536*_xform[2];
     _dvdy = 65536*_xform[3];
 
-    // For each display pixel in the four-pixel multisampling pattern,
-    // calculate the corresponding four u-v sampling offsets from the
-    // center of the corresponding pattern texel.
-    for (int i = 0; i < 4; ++i)
-    {
-        const XYPAIR *p = msaa4x4[i];
-        UVPAIR *q = _offset[i];
+    // Calculate the u-v sampling offsets for antialiasing
+    SetSampleOffsets(_offset, _dudx, _dvdx, _dudy, _dvdy, &_maxoffu, &_maxoffv);
 
-        for (int j = 0; j < 4; ++j)
-        {
-            q[j].u = (_dudx*p[j].x + _dudy*p[j].y)/8;
-            q[j].v = (_dvdx*p[j].x + _dvdy*p[j].y)/8;
-        }
-    }
+    // If no sampling offset reaches farther than one texel from the
+    // center texel, the samples never stray outside the border
+    _bInBorder = (_maxoffu < 0x00010000 && _maxoffv < 0x00010000);
 }
 
 // Constructor #1: Copy pattern from caller-supplied 2-D image array.
 // Input pixels are assumed to be in either 32-bit RGBA (0xaabbggrr)
-// format or 32-bit BGRA (0xaarrggbb) format.
+// format or 32-bit BGRA (0xaarrggbb) format. The caller is free to
+// modify the array afterward, so the image is not shared.
 Pattern::Pattern(const COLOR *pattern, float u0, float v0, int w, int h,
                  int stride, int flags, const float xform[6]) :
-           _w(0), _h(0), _xscroll(0), _yscroll(0)
+           _image(0), _w(0), _h(0), _xscroll(0), _yscroll(0)
 {
     if (pattern == 0 || w < 1 || h < 1 || stride < w)
         return;  // fail - invalid input parameters
 
     // Allocate 2-D array in which to store pattern
-    COLOR *pdata = new COLOR[w*h];
-    if (pdata == 0)
-    {
-        assert(pdata);
-        return;  // fail - out of memory
-    }
-    _pattern = new COLOR*[h];  // pointers to rows of pattern
-    if (_pattern == 0)
-    {
-        assert(_pattern);
-        delete[] pdata;
+    _image = store.NewImage(w, h, flags);
+    if (_image == 0)
         return;  // fail - out of memory
-    }
 
     // Copy pattern image into internal 2-D array
     // TODO - memcpy() call below can cause access violation
+    COLOR **texel = _image->tex->texel;
     for (int i = 0; i < h; ++i)
     {
-        memcpy(pdata, &pattern[0], w*sizeof(pattern[0]));
-        _pattern[i] = pdata;
-        pdata = &pdata[w];
+        memcpy(texel[i], &pattern[0], w*sizeof(pattern[0]));
         pattern = &pattern[stride];
     }
-    _w = w, _h = h;  // mark pattern as valid
+    ConvertTexels(_image->tex, flags);
     Init(u0, v0, flags, xform);  // finish initialization
 }
 
 // Constructor #2: Copy pattern from caller-specified image file via
 // an ImageReader object. Input pixels are assumed to be in either
 // 32-bit RGBA (0xaabbggrr) format or 32-bit BGRA (0xaarrggbb) format.
+// If the image reader names its source, the decoded image is kept in
+// the image store, and later patterns from the same source share it
+// instead of reading the source again.
 Pattern::Pattern(ImageReader *imgrdr, float u0, float v0,
                  int w, int h, int flags, const float xform[6]) :
-           _w(0), _h(0), _xscroll(0), _yscroll(0)
+           _image(0), _w(0), _h(0), _xscroll(0), _yscroll(0)
 {
     if (imgrdr == 0 || w < 1 || h < 1)
     {
@@ -272,44 +728,54 @@ Pattern::Pattern(ImageReader *imgrdr, float u0, float v0,
         return;  // fail - invalid input parameters
     }
 
-    // Allocate 2-D array in which to store pattern
-    COLOR *pdata = new COLOR[w*h];
-    if (pdata == 0)
-    {
-        assert(pdata);
-        return;  // fail - out of memory
-    }
-    _pattern = new COLOR*[h];  // pointers to rows of pattern
-    if (_pattern == 0)
+    // Has this image already been decoded?
+    const char *name = imgrdr->GetImageName();
+    long mtime = 0, fsize = 0;
+    if (name != 0)
     {
-        assert(_pattern);
-        delete[] pdata;
-        return;  // fail - out of memory
-    }
-    COLOR *ptmp = pdata;
-    for (int i = 0; i < h; ++i)
-    {
-        _pattern[i] = ptmp;
-        ptmp = &ptmp[w];
+        imgrdr->GetImageStamp(&mtime, &fsize);
+        _image = store.FindImage(name, mtime, fsize, w, h, flags);
     }
 
-    // Read entire pattern image into internal 2-D array
-    int count = imgrdr->ReadPixels(pdata, w*h);
-    if (count != w*h)
+    if (_image == 0)
     {
-        assert(count == w*h);
+        // Allocate 2-D array in which to store pattern
+        _image = store.NewImage(w, h, flags);
+        if (_image == 0)
+            return;  // fail - out of memory
+
+        // Read entire pattern image into a temporary buffer. Some image
+        // readers can't handle requests that end in mid-row, so we read
+        // the whole image at once before copying it to the 2-D array.
+        COLOR *pdata = new COLOR[w*h];
+        if (pdata == 0)
+        {
+            assert(pdata);
+            return;  // fail - out of memory
+        }
+        int count = imgrdr->ReadPixels(pdata, w*h);
+        if (count != w*h)
+        {
+            assert(count == w*h);
+            delete[] pdata;
+            return;  // fail - unexpected end of image data
+        }
+        COLOR **texel = _image->tex->texel;
+        for (int i = 0; i < h; ++i)
+            memcpy(texel[i], &pdata[i*w], w*sizeof(pdata[0]));
+
         delete[] pdata;
-        delete[] _pattern;
-        return;  // fail - unexpected end of image data
+        ConvertTexels(_image->tex, flags);
+        if (name != 0)
+            store.AddImage(_image, name, mtime, fsize);
     }
-    _w = w, _h = h;  // mark pattern as valid
     Init(u0, v0, flags, xform);  // finish initializing
 }
 
 Pattern::~Pattern()
 {
-    delete[] _pattern[0];
-    delete[] _pattern;
+    if (_image != 0)
+        store.ReleaseImage(_image);
 }
 
 // Returns true if the constructor succeeded; otherwise, returns false
@@ -344,6 +810,23 @@ void Pattern::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAl
     FIX16 v = 65536*(_xform[1]*xs + _xform[3]*ys + _xform[5]);
     int incr = (ys & 1) ? 2 : 0;
     UVPAIR *off[2] = { _offset[incr], _offset[incr+1] };
+    FIX16 ulo = _maxoffu, uhi = 0x00010000 - _maxoffu;
+    FIX16 vlo = _maxoffv, vhi = 0x00010000 - _maxoffv;
+
+    // Special case: The span steps through the pattern an integral
+    // number of texels at a time along a single row (for example, an
+    // untransformed pattern), and all four samples for every pixel
+    // fall inside the same texel
+    if (_dvdx == 0 && (_dudx & 0x0000ffff) == 0)
+    {
+        FIX16 ufrac = u & 0x0000ffff, vfrac = v & 0x0000ffff;
+
+        if (ulo <= ufrac && ufrac < uhi && vlo <= vfrac && vfrac < vhi)
+        {
+            FillNearest(u, v, len, outBuf, inAlpha);
+            return;
+        }
+    }
 
     // Each iteration of the for-loop below paints one pixel
     for (int k = 0; k < len; ++k)
@@ -354,29 +837,42 @@ void Pattern::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAl
         {
             COLOR texel, tmp, color, ga = 0, rb = 0;
             UVPAIR *poff = off[xs & 1];
-            int i0 = modulus(u >> 16, _w);
-            int j0 = modulus(v >> 16, _h);
+            int i0 = wrap(u >> 16, _w, _wmask);
+            int j0 = wrap(v >> 16, _h, _hmask);
+            FIX16 ufrac = u & 0x0000ffff, vfrac = v & 0x0000ffff;
 
             // Map pixel center to u-v coordinate space
-            u = (u & 0x0000ffff) | (i0 << 16);
-            v = (v & 0x0000ffff) | (j0 << 16);
+            u = ufrac | (i0 << 16);
+            v = vfrac | (j0 << 16);
 
-            // Do antialiasing with 4-point multisampling
-            for (int n = 0; n < 4; ++n)
+            if (ulo <= ufrac && ufrac < uhi && vlo <= vfrac && vfrac < vhi)
             {
-                int i = (u + poff[n].u) >> 16;
-                int j = (v + poff[n].v) >> 16;
-
-                i = modulus(i, _w);
-                j = modulus(j, _h);
-                texel = _pattern[j][i];
-                tmp = texel & 0x00ff00ff;
-                rb += tmp;
-                ga += (texel ^ tmp) >> 8;
+                // All four samples fall inside the same texel (as is
+                // typical for a magnified pattern), so skip averaging
+                color = _pattern[j0][i0];
+            }
+            else
+            {
+                // Do antialiasing with 4-point multisampling
+                for (int n = 0; n < 4; ++n)
+                {
+                    int i = (u + poff[n].u) >> 16;
+                    int j = (v + poff[n].v) >> 16;
+
+                    if (!_bInBorder)
+                    {
+                        i = wrap(i, _w, _wmask);
+                        j = wrap(j, _h, _hmask);
+                    }
+                    texel = _pattern[j][i];
+                    tmp = texel & 0x00ff00ff;
+                    rb += tmp;
+                    ga += (texel ^ tmp) >> 8;
+                }
+                ga &= 0x03fc03fc;
+                rb &= 0x03fc03fc;
+                color = (ga << 6) | (rb >> 2);
             }
-            ga &= 0x03fc03fc;
-            rb &= 0x03fc03fc;
-            color = (ga << 6) | (rb >> 2);
             color = MultiplyByOpacity(color, opacity);
             outBuf[k] = color;
         }
@@ -385,6 +881,218 @@ void Pattern::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAl
     }
 }
 
+// Private function: Fills a span for the special case in which each
+// pixel maps to exactly one texel (all four multisamples fall inside
+// the same texel), the span lies along a single row of the pattern,
+// and successive pixels are an integral number of texels apart. In
+// the common case of an untransformed pattern, the texels are simply
+// copied, with wraparound, from the pattern row.
+void Pattern::FillNearest(FIX16 u, FIX16 v, int len, COLOR outBuf[], const COLOR inAlpha[])
+{
+    const COLOR *row = _pattern[wrap(v >> 16, _h, _hmask)];
+    int i = wrap(u >> 16, _w, _wmask);
+    int step = _dudx >> 16;
+
+    if (step == 1 && inAlpha == 0)
+    {
+        // Copy texels from pattern row, wrapping around at the end
+        while (len > 0)
+        {
+            int count = min(len, _w - i);
+
+            memcpy(outBuf, &row[i], count*sizeof(outBuf[0]));
+            outBuf = &outBuf[count];
+            len -= count;
+            i = 0;
+        }
+        return;
+    }
+    for (int k = 0; k < len; ++k)
+    {
+        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[k];
+
+        if (opacity != 0)
+            outBuf[k] = MultiplyByOpacity(row[i], opacity);
+
+        i = wrap(i + step, _w, _wmask);
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// MaskPattern class -- Paint generator for tiled pattern fills from
+// an 8-bit alpha-only (A8) mask, such as a coverage mask rendered by
+// a renderer from CreateAlphaRenderer. Each pixel is painted with a
+// solid color, and the alpha sampled from the mask is mixed with the
+// color's alpha. The mask is sampled in place, so it is neither
+// copied nor expanded to 32-bit pixels, and the caller must keep it
+// unchanged for as long as the MaskPattern object is in use. Unlike
+// the Pattern class, this class doesn't mipmap a shrunken mask.
+//
+//---------------------------------------------------------------------
+
+class MaskPattern : public TiledPattern
+{
+    const unsigned char *_mask;  // caller's 8-bit alpha values
+    int _stride;          // mask stride, in bytes
+    COLOR _color;         // premultiplied BGRA paint color
+    int _w, _h;           // width and height of mask
+    int _wmask, _hmask;   // w-1 and h-1 if power of two; else -1
+    float _xform[6];      // affine transformation matrix
+    FIX16 _dudx;          // partial derivative du/dx
+    FIX16 _dvdx;          // partial derivative dv/dx
+    UVPAIR _offset[4][4]; // multisampling offsets for antialiasing
+    FIX16 _maxoffu;       // max magnitude of u sampling offsets
+    FIX16 _maxoffv;       // max magnitude of v sampling offsets
+    int _xscroll, _yscroll; // scroll position coordinates
+
+    void FillNearest(FIX16 u, FIX16 v, int len, COLOR outBuf[], const COLOR inAlpha[]);
+
+public:
+    MaskPattern(const unsigned char *mask, COLOR color, float u0, float v0,
+                int w, int h, int stride, int flags, const float xform[6]);
+    ~MaskPattern() {}
+    bool GetStatus();  // for local use only
+    void FillSpan(int xs, int ys, int length, COLOR outBuf[], const COLOR inAlpha[]);
+    bool SetScrollPosition(int x, int y);
+};
+
+// Constructor: Parameter 'color' is the paint color, which is in
+// premultiplied-alpha BGRA (0xaarrggbb) format. Parameter 'stride' is
+// the distance, in bytes, from the start of one row of the mask to
+// the start of the next row.
+MaskPattern::MaskPattern(const unsigned char *mask, COLOR color, float u0, float v0,
+                         int w, int h, int stride, int flags, const float xform[6]) :
+               _mask(mask), _stride(stride), _color(color), _w(0), _h(0),
+               _xscroll(0), _yscroll(0)
+{
+    if (mask == 0 || w < 1 || h < 1 || stride < w)
+        return;  // fail - invalid input parameters
+
+    SetPatternXform(_xform, xform, u0, v0, flags);
+    _w = w, _h = h;  // mark pattern as valid
+    _wmask = (_w & (_w - 1)) ? -1 : _w - 1;
+    _hmask = (_h & (_h - 1)) ? -1 : _h - 1;
+    _dudx = 65536*_xform[0];
+    _dvdx = 65536*_xform[1];
+    SetSampleOffsets(_offset, _dudx, _dvdx, 65536*_xform[2],
+                     65536*_xform[3], &_maxoffu, &_maxoffv);
+}
+
+// Returns true if the constructor succeeded; otherwise, returns false
+bool MaskPattern::GetStatus()
+{
+    return (_w > 0);
+}
+
+// Public function
+bool MaskPattern::SetScrollPosition(int x, int y)
+{
+    _xscroll = x, _yscroll = y;
+    return true;
+}
+
+// Public function: Fills the pixels in a single horizontal span with
+// the paint color, as modulated by the tiled mask. The span starts at
+// pixel (xs,ys) and extends to the right for len pixels. The inAlpha
+// array contains 8-bit alpha values to apply to the pixels in addition
+// to the alphas from the mask.
+void MaskPattern::FillSpan(int xs, int ys, int len, COLOR outBuf[], const COLOR inAlpha[])
+{
+    if (_w == 0)
+        return;  // fail - pattern initialization failed
+
+    // Map starting point (xs,ys) to mask u-v coordinates
+    xs += _xscroll, ys += _yscroll;
+    FIX16 u = 65536*(_xform[0]*xs + _xform[2]*ys + _xform[4]);
+    FIX16 v = 65536*(_xform[1]*xs + _xform[3]*ys + _xform[5]);
+    int incr = (ys & 1) ? 2 : 0;
+    UVPAIR *off[2] = { _offset[incr], _offset[incr+1] };
+    FIX16 ulo = _maxoffu, uhi = 0x00010000 - _maxoffu;
+    FIX16 vlo = _maxoffv, vhi = 0x00010000 - _maxoffv;
+
+    // Special case: The span steps through the mask an integral number
+    // of texels at a time along a single row (for example, a mask that
+    // is aligned to the pixel grid), and all four samples for every
+    // pixel fall inside the same texel
+    if (_dvdx == 0 && (_dudx & 0x0000ffff) == 0)
+    {
+        FIX16 ufrac = u & 0x0000ffff, vfrac = v & 0x0000ffff;
+
+        if (ulo <= ufrac && ufrac < uhi && vlo <= vfrac && vfrac < vhi)
+        {
+            FillNearest(u, v, len, outBuf, inAlpha);
+            return;
+        }
+    }
+
+    // Each iteration of the for-loop below paints one pixel
+    for (int k = 0; k < len; ++k)
+    {
+        COLOR opacity = (inAlpha == 0) ? 255 : inAlpha[k];
+
+        if (opacity != 0)
+        {
+            COLOR alpha;
+            FIX16 ufrac = u & 0x0000ffff, vfrac = v & 0x0000ffff;
+
+            if (ulo <= ufrac && ufrac < uhi && vlo <= vfrac && vfrac < vhi)
+            {
+                // All four samples fall inside the same texel
+                int i = wrap(u >> 16, _w, _wmask);
+                int j = wrap(v >> 16, _h, _hmask);
+
+                alpha = _mask[j*_stride + i];
+            }
+            else
+            {
+                // Do antialiasing with 4-point multisampling
+                UVPAIR *poff = off[(xs + k) & 1];
+
+                alpha = 0;
+                for (int n = 0; n < 4; ++n)
+                {
+                    int i = wrap((u + poff[n].u) >> 16, _w, _wmask);
+                    int j = wrap((v + poff[n].v) >> 16, _h, _hmask);
+
+                    alpha += _mask[j*_stride + i];
+                }
+                alpha >>= 2;
+            }
+            alpha = alpha*opacity + 128;
+            alpha += alpha >> 8;
+            outBuf[k] = MultiplyByOpacity(_color, alpha >> 8);
+        }
+        u += _dudx;
+        v += _dvdx;
+    }
+}
+
+// Private function: Fills a span for the special case in which each
+// pixel maps to exactly one mask value, the span lies along a single
+// row of the mask, and successive pixels are an integral number of
+// mask values apart. The mask values are read straight from the row.
+void MaskPattern::FillNearest(FIX16 u, FIX16 v, int len, COLOR outBuf[], const COLOR inAlpha[])
+{
+    const unsigned char *row = &_mask[wrap(v >> 16, _h, _hmask)*_stride];
+    int i = wrap(u >> 16, _w, _wmask);
+    int step = _dudx >> 16;
+
+    for (int k = 0; k < len; ++k)
+    {
+        COLOR alpha = row[i];
+
+        if (inAlpha != 0)
+        {
+            alpha = alpha*inAlpha[k] + 128;
+            alpha += alpha >> 8;
+            alpha >>= 8;
+        }
+        outBuf[k] = MultiplyByOpacity(_color, alpha);
+        i = wrap(i + step, _w, _wmask);
+    }
+}
+
 // Called by a renderer to create a new tiled-pattern object
 //
 TiledPattern* CreateTiledPattern(const COLOR *pattern, float u0, float v0,
@@ -414,7 +1122,31 @@ TiledPattern* CreateTiledPattern(ImageReader *imgrdr, float u0, float v0,
     return pat;  // success
 }
 
+// Called by a renderer to create a tiled-pattern object that paints
+// a solid color through an 8-bit alpha mask. The mask isn't copied.
+//
+TiledPattern* CreateMaskPattern(const unsigned char *mask, COLOR color,
+                                float u0, float v0, int w, int h,
+                                int stride, int flags, const float xform[6])
+{
+    MaskPattern *pat = new MaskPattern(mask, color, u0, v0, w, h,
+                                       stride, flags, xform);
+    if (pat == 0 || pat->GetStatus() == false)
+    {
+        assert(pat != 0 && pat->GetStatus() == true);
+        delete pat;
+        return 0;  // constructor failed
+    }
+    return pat;  // success
+}
 
-
-
-
+// Sets the limit, in bytes, on the memory used by the decoded pattern
+// images that are kept for reuse. When the limit is exceeded, unused
+// images are discarded, least recently used first. Images in use by
+// TiledPattern objects are never discarded. Setting the limit to zero
+// frees all the images that are not in use.
+//
+void SetPatternImageLimit(int maxbytes)
+{
+    store.SetLimit(maxbytes);
+}
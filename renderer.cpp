@@ -94,7 +94,8 @@ COLOR* DeleteRawPixels(COLOR *buf)
 // function returns true if the 'subbuf' pixel buffer fits within the
 // bounds of the 'bigbuf' pixel buffer. Otherwise, it returns false. If
 // the contents of 'bigbuf' or 'bbox' are not valid, the results are
-// undefined.
+// undefined. The pixel buffer can contain either 32-bit pixels or
+// 8-bit alpha values.
 bool DefineSubregion(PIXEL_BUFFER& subbuf, const PIXEL_BUFFER& bigbuf, const SGRect& bbox)
 {
     int xmax = bbox.x + bbox.w - 1;
@@ -102,13 +103,13 @@ bool DefineSubregion(PIXEL_BUFFER& subbuf, const PIXEL_BUFFER& bigbuf, const SGR
     bool valid = bigbuf.pixels &&
                  bbox.x >= 0 && bbox.y >= 0 &&
                  xmax < bigbuf.width && ymax < bigbuf.height;
-    int stride = bigbuf.pitch/sizeof(COLOR);
+    int offset = bbox.x*(bigbuf.depth/8) + bbox.y*bigbuf.pitch;
     subbuf.width = bbox.w;
     subbuf.height = bbox.h;
     subbuf.pitch = bigbuf.pitch;
     subbuf.depth = bigbuf.depth;
     if (valid)
-        subbuf.pixels = &bigbuf.pixels[bbox.x + stride*bbox.y];
+        subbuf.pixels = (COLOR*)((char*)bigbuf.pixels + offset);
     else
         subbuf.pixels = 0;
     return valid;
@@ -142,6 +143,7 @@ public:
     BasicRenderer(const PIXEL_BUFFER *backbuf);
     ~BasicRenderer() {}
     void SetColor(COLOR color);
+    void Clear(COLOR color);
 };
 
 BasicRenderer::BasicRenderer(const PIXEL_BUFFER *backbuf)
@@ -186,6 +188,23 @@ void BasicRenderer::SetColor(COLOR color)
     _color = (0xff << 24) | (r << 16) | (g << 8) | b;
 }
 
+// Sets all the pixels in the back buffer to the specified color
+void BasicRenderer::Clear(COLOR color)
+{
+    COLOR oldcolor = _color;
+
+    SetColor(color);
+    COLOR *prow = _backbuf.pixels;
+    for (int j = 0; j < _backbuf.height; ++j)
+    {
+        for (int i = 0; i < _backbuf.width; ++i)
+            prow[i] = _color;
+
+        prow = &prow[_stride];
+    }
+    _color = oldcolor;
+}
+
 //---------------------------------------------------------------------
 //
 // Utility functions used by EnhancedRenderer to do alpha blending
@@ -346,6 +365,106 @@ namespace {
             }
         }
     }
+
+    // The next three functions perform the same blend operations as
+    // the three functions above, except that each destination pixel
+    // is an 8-bit alpha value (as in an A8 coverage mask). Only the
+    // alpha fields of the 32-bit source pixels are used.
+    void AlphaBlenderA8(unsigned char *dst, const COLOR *src, int len)
+    {
+        while (len--)
+        {
+            COLOR alpha = *src++ >> 24;
+
+            if (alpha == 255)
+            {
+                *dst = 255;
+            }
+            else if (alpha != 0)
+            {
+                COLOR a = *dst*(255 - alpha) + 128;
+                a += a >> 8;
+                *dst = alpha + (a >> 8);
+            }
+            ++dst;
+        }
+    }
+
+    void AddWithSaturationA8(unsigned char *dst, const COLOR *src, int len)
+    {
+        while (len--)
+        {
+            COLOR a = *dst + (*src++ >> 24);
+
+            *dst++ = (a < 256) ? a : 255;
+        }
+    }
+
+    void AlphaClearA8(unsigned char *dst, const COLOR *src, int len)
+    {
+        while (len--)
+        {
+            COLOR anot = ~*src++ >> 24;
+
+            if (anot != 255)
+            {
+                COLOR a = *dst*anot + 128;
+                a += a >> 8;
+                *dst = a >> 8;
+            }
+            ++dst;
+        }
+    }
+
+    // Multiplies a row of premultiplied-alpha source pixels by the
+    // corresponding 8-bit coverage values in a clipping mask
+    void ApplyClipMask(COLOR *src, const unsigned char *mask, int len)
+    {
+        while (len--)
+        {
+            COLOR m = *mask++;
+            COLOR srcpix = *src;
+
+            if (m == 0)
+            {
+                *src = 0;
+            }
+            else if (m != 255 && srcpix != 0)
+            {
+                COLOR rb = srcpix & 0x00ff00ff;
+                COLOR ga = (srcpix ^ rb) >> 8;
+                rb *= m;
+                rb += 0x00800080;
+                rb += (rb >> 8) & 0x00ff00ff;
+                rb = (rb >> 8) & 0x00ff00ff;
+                ga *= m;
+                ga += 0x00800080;
+                ga += (ga >> 8) & 0x00ff00ff;
+                ga &= 0xff00ff00;
+                *src = ga | rb;
+            }
+            ++src;
+        }
+    }
+
+    // Returns true if every 8-bit value in a clipping mask is zero
+    bool IsMaskEmpty(const unsigned char *mask, int size)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            if (mask[i] != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // Multiplies two 8-bit alpha or coverage values
+    inline COLOR MulAlpha(COLOR a, COLOR b)
+    {
+        COLOR ab = a*b + 128;
+        ab += ab >> 8;
+        return ab >> 8;
+    }
 }  // end namespace
 
 //---------------------------------------------------------------------
@@ -360,6 +479,17 @@ namespace {
 // Before being processed, input pixels in RGBA (0xaabbggrr) format
 // are converted to BGRA format and premultiplied by their alphas.
 //
+// This renderer can also render to an 8-bit, alpha-only (A8) pixel
+// buffer, which is typically used as a coverage mask (for example,
+// the source image for a drop shadow). In this case, only the alpha
+// fields of the source pixels are blended into the pixel buffer.
+//
+// To support coverage-mask clipping, the renderer can rasterize a
+// clipping region into an 8-bit clipping mask that has the same width
+// as the device clipping rectangle and the same height as the pixel
+// buffer. The mask values are multiplied into the painted pixels
+// before they are blended into the pixel buffer.
+//
 //---------------------------------------------------------------------
 
 class AA4x8Renderer : public EnhancedRenderer
@@ -367,7 +497,7 @@ class AA4x8Renderer : public EnhancedRenderer
     friend ShapeGen;
 
     PIXEL_BUFFER _pixbuf;  // pixel buffer descriptor
-    int _stride;       // stride in pixels = pitch/sizeof(COLOR)
+    int _stride;       // stride in pixels = pitch/(depth/8)
     bool _pixalloc;    // true if we allocated the pixel memory
     COLOR *_linebuf;   // pixel data bits in scanline buffer
     COLOR _alpha;      // source constant alpha
@@ -376,16 +506,22 @@ class AA4x8Renderer : public EnhancedRenderer
     int _maxwidth;     // width (in pixels) of device clipping rect
     int *_aabuf;       // AA-buffer data bits (32 bits per pixel)
     int *_aarow[4];    // AA-buffer organized as 4 subpixel rows
-    int _lut[33];      // look-up table for source alpha/RGB values
+    COLOR _lut[33];    // look-up table for source alpha/RGB values
     PaintGen *_paintgen;  // paint generator (gradients, patterns)
     COLOR_STOP _cstop[STOPARRAY_MAXLEN+1];  // color-stop array
     int _stopCount;    // Number of elements in color-stop array
     float _xform[6];   // Transform matrix (gradients, patterns)
     float *_pxform;    // Pointer to transform matrix
     int _xscroll, _yscroll;  // Scroll position coordinates
+    unsigned char *_clipmask;  // clipping mask (null if no mask)
+    unsigned char *_savemask;  // saved copy of clipping mask
+    unsigned char *_maskbuf;   // mask being rasterized by UpdateClipMask
+    CLIPMASKOP _maskop;        // how to combine shape with _maskbuf
 
     void FillSubpixelSpan(int xL, int xR, int ysub);
     void RenderAbuffer(int xmin, int xmax, int yscan);
+    void RenderLineBuffer(int xleft, int len, int yscan);
+    void RenderMaskRow(int xleft, int len, int yscan);
     void BlendLUT(COLOR component);
     void BlendConstantAlphaLUT();
 
@@ -394,6 +530,9 @@ protected:
     bool SetMaxWidth(int maxwidth);
     int QueryYResolution() { return 2; }
     bool SetScrollPosition(int x, int y);
+    bool QueryClipMask() { return true; }
+    bool UpdateClipMask(CLIPMASKOP op, ShapeFeeder *feeder);
+    bool RenderRect(const SGRect *rect);
 
 public:
     bool GetStatus();  // for local use only
@@ -403,6 +542,7 @@ public:
     ~AA4x8Renderer();
     bool GetPixelBuffer(PIXEL_BUFFER *pixbuf);
     void SetColor(COLOR color);
+    void Clear(COLOR color);
     bool SetPattern(const COLOR *pattern, float u0, float v0,
                     int w, int h, int stride, int flags);
     bool SetPattern(ImageReader *imgrdr, float u0, float v0,
@@ -418,6 +558,7 @@ public:
     void AddColorStop(float offset, COLOR color);
     void ResetColorStops() { _stopCount = 0; }
     void SetTransform(const float xform[6]);
+    bool GetTransform(float xform[6]);
     void SetConstantAlpha(COLOR alpha);
     void SetBlendOperation(BLENDOP blendop);
 };
@@ -426,31 +567,38 @@ AA4x8Renderer::AA4x8Renderer(const PIXEL_BUFFER *pixbuf) :
                     _maxwidth(0), _linebuf(0), _aabuf(0), _paintgen(0),
                     _stopCount(0), _pxform(0), _color(0), _alpha(255),
                     _xscroll(0), _yscroll(0), _pixalloc(false),
-                    _blendop(BLENDOP_SRC_OVER_DST)
+                    _blendop(BLENDOP_SRC_OVER_DST), _clipmask(0),
+                    _savemask(0), _maskbuf(0), _maskop(CLIPMASK_INTERSECT)
 {
-    if (pixbuf->width < 1 || pixbuf->height < 1 || pixbuf->depth != 32 ||
-        (pixbuf->pitch/sizeof(COLOR) < pixbuf->width && pixbuf->pixels))
+    if (pixbuf->width < 1 || pixbuf->height < 1 ||
+        (pixbuf->depth != 32 && pixbuf->depth != 8) ||
+        (pixbuf->pitch/(pixbuf->depth/8) < pixbuf->width && pixbuf->pixels))
     {
         assert(pixbuf->width > 0 && pixbuf->height > 0);
-        assert(pixbuf->depth == 32);
-        assert(pixbuf->pitch/sizeof(COLOR) >= pixbuf->width && pixbuf->pixels);
+        assert(pixbuf->depth == 32 || pixbuf->depth == 8);
+        assert(pixbuf->pitch/(pixbuf->depth/8) >= pixbuf->width && pixbuf->pixels);
         _pixbuf.pixels = 0;
         return;  // bad parameter
     }
     _pixbuf = *pixbuf;
     if (_pixbuf.pixels == 0)
     {
-        // The caller wants us to allocate a pixel buffer
-        _pixbuf.pixels = AllocateRawPixels(_pixbuf.width, _pixbuf.height, RGBA(0,0,0,0));
+        // The caller wants us to allocate a pixel buffer. Rows of 8-bit
+        // alpha values are padded to a multiple of four bytes.
+        int w = _pixbuf.width;
+        if (_pixbuf.depth == 8)
+            w = (w + 3)/4;
+
+        _pixbuf.pixels = AllocateRawPixels(w, _pixbuf.height, RGBA(0,0,0,0));
         if (_pixbuf.pixels == 0)
         {
             assert(_pixbuf.pixels != 0);
             return;  // fail - out of memory
         }
         _pixalloc = true;  // don't forget we allocated pixel memory
-        _pixbuf.pitch = _pixbuf.width*sizeof(COLOR);
+        _pixbuf.pitch = w*sizeof(COLOR);
     }
-    _stride = _pixbuf.pitch/sizeof(COLOR);
+    _stride = _pixbuf.pitch/(_pixbuf.depth/8);
     memset(&_lut[0], 0, sizeof(_lut));
     memset(&_aarow[0], 0, sizeof(_aarow));
     memset(&_cstop[0], 0, sizeof(_cstop));
@@ -462,10 +610,12 @@ AA4x8Renderer::~AA4x8Renderer()
 {
     delete[] _aabuf;
     delete[] _linebuf;
+    delete[] _clipmask;
+    delete[] _savemask;
     if (_pixalloc)
         DeleteRawPixels(_pixbuf.pixels);
     if (_paintgen)
-        _paintgen->~PaintGen();
+        delete _paintgen;
 }
 
 // Returns true if constructor succeeded; otherwise, returns false.
@@ -488,7 +638,7 @@ bool AA4x8Renderer::GetPixelBuffer(PIXEL_BUFFER *pixbuf)
 // Protected function: ShapeGen calls this function to notify the
 // renderer when the width of the device clipping rectangle changes.
 // This function rebuilds the AA-buffer and the scan-line buffer to
-// accommodate the new width.
+// accommodate the new width. Any clipping masks are discarded.
 bool AA4x8Renderer::SetMaxWidth(int width)
 {
     // Pad out specified width to be multiple of four
@@ -497,6 +647,7 @@ bool AA4x8Renderer::SetMaxWidth(int width)
     if (_maxwidth != width)
     {
         _maxwidth = width;
+        UpdateClipMask(CLIPMASK_INIT, 0);
 
         // Allocate buffer to store one scan line of BGRA pixels
         delete[] _linebuf;
@@ -647,15 +798,45 @@ void AA4x8Renderer::RenderAbuffer(int xmin, int xmax, int yscan)
         }
     }
 
-    // If this fill uses a paint generator, call its FillSpan function
     int xleft = xmin/8, xright = (xmax + 7)/8;
-    int len = xright - xleft;
+    RenderLineBuffer(xleft, xright - xleft, yscan);
+}
+
+// Private function: Paints the len pixels starting at _linebuf[xleft]
+// and blends them into scan line yscan of the back buffer. On entry,
+// these pixels contain the fill color multiplied by the pixel coverage.
+void AA4x8Renderer::RenderLineBuffer(int xleft, int len, int yscan)
+{
     COLOR *srcbuf = &_linebuf[xleft];
 
+    // If this fill uses a paint generator, call its FillSpan function
+    if (_maskbuf)
+    {
+        RenderMaskRow(xleft, len, yscan);
+        return;
+    }
     if (_paintgen)
         _paintgen->FillSpan(xleft, yscan, len, srcbuf, srcbuf);
 
+    // Clip the painted pixels to the clipping mask
+    if (_clipmask)
+        ApplyClipMask(srcbuf, &_clipmask[yscan*_maxwidth + xleft], len);
+
     // Blend the painted pixels into the back buffer
+    if (_pixbuf.depth == 8)
+    {
+        unsigned char *dest8 = (unsigned char*)_pixbuf.pixels;
+
+        dest8 = &dest8[yscan*_stride + xleft];
+        if (_blendop == BLENDOP_SRC_OVER_DST)
+            AlphaBlenderA8(dest8, srcbuf, len);
+        else if (_blendop == BLENDOP_ADD_WITH_SAT)
+            AddWithSaturationA8(dest8, srcbuf, len);
+        else
+            AlphaClearA8(dest8, srcbuf, len);
+
+        return;
+    }
     COLOR *dest = &_pixbuf.pixels[yscan*_stride + xleft];
 
     if (_blendop == BLENDOP_SRC_OVER_DST)
@@ -666,6 +847,187 @@ void AA4x8Renderer::RenderAbuffer(int xmin, int xmax, int yscan)
         AlphaClear(dest, srcbuf, len);
 }
 
+// Private function: Called by RenderAbuffer to update the clipping
+// mask that is being rasterized by UpdateClipMask. The _linebuf array
+// contains 8-bit coverage values (in the alpha fields) for the pixels
+// in the current scan line. These values are multiplied into the new
+// mask either directly (to intersect the mask with the interior of the
+// shape) or inverted (to intersect it with the shape's exterior).
+void AA4x8Renderer::RenderMaskRow(int xleft, int len, int yscan)
+{
+    int offset = yscan*_maxwidth + xleft;
+    unsigned char *pmask = &_maskbuf[offset];
+    const COLOR *src = &_linebuf[xleft];
+
+    if (_maskop == CLIPMASK_EXCLUDE)
+    {
+        for (int i = 0; i < len; ++i)
+            pmask[i] = MulAlpha(pmask[i], 255 - (src[i] >> 24));
+    }
+    else if (_clipmask)
+    {
+        const unsigned char *pold = &_clipmask[offset];
+        for (int i = 0; i < len; ++i)
+            pmask[i] = MulAlpha(pold[i], src[i] >> 24);
+    }
+    else
+    {
+        for (int i = 0; i < len; ++i)
+            pmask[i] = src[i] >> 24;
+    }
+}
+
+// Protected function: ShapeGen calls this function to update the
+// clipping mask. For the CLIPMASK_INTERSECT and CLIPMASK_EXCLUDE
+// operations, the shape supplied by the feeder is rasterized through
+// the AA-buffer into a new mask, which replaces the current mask. The
+// other operations reset, save, or swap the mask. Returns true if the
+// current mask is not empty (no mask at all means no clipping).
+bool AA4x8Renderer::UpdateClipMask(CLIPMASKOP op, ShapeFeeder *feeder)
+{
+    int size = _maxwidth*_pixbuf.height;
+    unsigned char *swap;
+
+    switch (op)
+    {
+    case CLIPMASK_INIT:
+        delete[] _savemask;
+        _savemask = 0;
+        // fall through
+    case CLIPMASK_RESET:
+        delete[] _clipmask;
+        _clipmask = 0;
+        return true;
+    case CLIPMASK_SAVE:
+        delete[] _savemask;
+        _savemask = 0;
+        if (_clipmask == 0)
+            return true;
+
+        _savemask = new unsigned char[size];
+        if (_savemask == 0)
+        {
+            assert(_savemask != 0);
+            return false;  // out of memory
+        }
+        memcpy(_savemask, _clipmask, size);
+        return !IsMaskEmpty(_clipmask, size);
+    case CLIPMASK_SWAP:
+        swap = _clipmask;  _clipmask = _savemask;  _savemask = swap;
+        return (_clipmask == 0 || !IsMaskEmpty(_clipmask, size));
+    case CLIPMASK_INTERSECT:
+    case CLIPMASK_EXCLUDE:
+        break;
+    default:
+        assert(0);
+        return false;
+    }
+    if (feeder == 0 || _pixbuf.pixels == 0 || size == 0)
+    {
+        assert(feeder != 0 && _pixbuf.pixels != 0 && size != 0);
+        return false;  // bad parameter
+    }
+    _maskbuf = new unsigned char[size];
+    if (_maskbuf == 0)
+    {
+        assert(_maskbuf != 0);
+        return false;  // out of memory
+    }
+
+    // Pixels outside the shape are excluded from the interior of the
+    // shape, but are unaffected by excluding the shape's exterior
+    if (op == CLIPMASK_INTERSECT)
+        memset(_maskbuf, 0, size);
+    else if (_clipmask)
+        memcpy(_maskbuf, _clipmask, size);
+    else
+        memset(_maskbuf, 255, size);
+
+    // Temporarily load the look-up table with the 8-bit alpha values
+    // for all possible coverage counts, and disable any paint generator
+    COLOR lut[ARRAY_LEN(_lut)];
+    PaintGen *paintgen = _paintgen;
+
+    memcpy(lut, _lut, sizeof(lut));
+    for (int i = 0; i < ARRAY_LEN(_lut); ++i)
+        _lut[i] = ((255*i + 16)/32) << 24;
+
+    _paintgen = 0;
+    _maskop = op;
+    RenderShape(feeder);
+    _paintgen = paintgen;
+    memcpy(_lut, lut, sizeof(lut));
+
+    delete[] _clipmask;
+    _clipmask = _maskbuf;
+    _maskbuf = 0;
+    return !IsMaskEmpty(_clipmask, size);
+}
+
+// Protected function: ShapeGen calls this function to fill a clipped,
+// axis-aligned rectangle. The rectangle's x coordinates are in the
+// same fixed-point format as the x coordinates in a subpixel span, and
+// its y coordinates are subpixel scan lines. The coverage of each pixel
+// is the product of the number of subpixel rows and the number of
+// subpixel columns that the rectangle covers in that pixel, so the
+// AA-buffer isn't needed, and the pixels are painted exactly as if the
+// rectangle's spans had been supplied by a feeder. A fully covered
+// pixel in an opaque, solid-color fill is written directly to the back
+// buffer; only the pixels on the border need to be blended.
+bool AA4x8Renderer::RenderRect(const SGRect *rect)
+{
+    if (_pixbuf.pixels == 0 || _maskbuf != 0)
+    {
+        assert(_pixbuf.pixels != 0 && _maskbuf == 0);
+        return false;
+    }
+
+    const int FIX_BIAS = 0x00007fff;
+    int xL = (rect->x + FIX_BIAS/8 - FIX_BIAS) >> 13;
+    int xR = (rect->x + rect->w + FIX_BIAS/8 - FIX_BIAS) >> 13;
+    int ytop = rect->y, ybot = rect->y + rect->h;
+
+    assert(xL >= 0 && ytop >= 0);
+    if (xL >= xR || ytop >= ybot)
+        return true;  // rectangle falls into a gap between subpixels
+
+    int xleft = xL/8, xright = (xR + 7)/8;
+    int len = xright - xleft;
+    int colsL = min(xR, 8*xleft + 8) - xL;      // subpixels in 1st pixel
+    int colsR = xR - max(xL, 8*(xright - 1));  // subpixels in last pixel
+    bool bopaque = (_paintgen == 0 && _clipmask == 0 &&
+                    _blendop == BLENDOP_SRC_OVER_DST &&
+                    _pixbuf.depth == 32 && (_lut[32] >> 24) == 255);
+
+    for (int yscan = ytop/4; 4*yscan < ybot; ++yscan)
+    {
+        int rows = min(ybot, 4*yscan + 4) - max(ytop, 4*yscan);
+        COLOR fill = _lut[8*rows];
+
+        if (bopaque && rows == 4 && len > 2)
+        {
+            COLOR *dest = &_pixbuf.pixels[yscan*_stride + xleft];
+            COLOR border[2] = { _lut[rows*colsL], _lut[rows*colsR] };
+
+            AlphaBlender(&dest[0], &border[0], 1);
+            for (int i = 1; i < len - 1; ++i)
+                dest[i] = fill;
+
+            AlphaBlender(&dest[len-1], &border[1], 1);
+            continue;
+        }
+
+        COLOR *srcbuf = &_linebuf[xleft];
+        for (int i = 1; i < len - 1; ++i)
+            srcbuf[i] = fill;
+
+        srcbuf[len-1] = _lut[rows*colsR];
+        srcbuf[0] = _lut[rows*colsL];
+        RenderLineBuffer(xleft, len, yscan);
+    }
+    return true;
+}
+
 // Private function: Loads an RGB color component or alpha value into
 // the look-up table in the _lut array. The array is loaded with 33
 // elements corresponding to all possible per-pixel alpha values
@@ -709,7 +1071,7 @@ void AA4x8Renderer::SetColor(COLOR color)
     _color = color;
     if (_paintgen)
     {
-        _paintgen->~PaintGen();
+        delete _paintgen;
         _paintgen = 0;
     }
     opacity += 128;
@@ -722,6 +1084,43 @@ void AA4x8Renderer::SetColor(COLOR color)
         BlendLUT((color >> shift) & 255);
 }
 
+// Public function: Sets all the pixels in the pixel buffer to the
+// specified color, without blending. The color is converted to
+// premultiplied-alpha BGRA format, as described for SetColor. The
+// source-constant alpha and the clipping region are ignored.
+void AA4x8Renderer::Clear(COLOR color)
+{
+    if (_pixbuf.pixels == 0)
+    {
+        assert(_pixbuf.pixels);
+        return;  // not a valid pixel buffer
+    }
+    color = PremultAlpha(color);
+    if (_pixbuf.depth == 8)
+    {
+        unsigned char *dest8 = (unsigned char*)_pixbuf.pixels;
+        for (int j = 0; j < _pixbuf.height; ++j)
+        {
+            memset(dest8, color >> 24, _pixbuf.width);
+            dest8 = &dest8[_stride];
+        }
+        return;
+    }
+
+    // Swap red and blue components to convert RGBA to BGRA
+    COLOR rb = color & 0x00ff00ff;
+    color ^= rb;
+    color |= (rb >> 16) | (rb << 16);
+    COLOR *prow = _pixbuf.pixels;
+    for (int j = 0; j < _pixbuf.height; ++j)
+    {
+        for (int i = 0; i < _pixbuf.width; ++i)
+            prow[i] = color;
+
+        prow = &prow[_stride];
+    }
+}
+
 void AA4x8Renderer::SetConstantAlpha(COLOR alpha)
 {
     _alpha = alpha & 255;
@@ -744,15 +1143,43 @@ bool AA4x8Renderer::SetScrollPosition(int x, int y)
 }
 
 // Public function: Prepares the renderer to do tiled-pattern fills
-// from a pixel array containing a 2-D image
+// from a pixel array containing a 2-D image. If the FLAG_IMAGE_A8 flag
+// is set, the array contains 8-bit alpha values (for example, a mask
+// rendered to an A8 pixel buffer), and the 'stride' parameter is in
+// bytes. Each alpha value is then mixed with the current solid color
+// (that is, the color from the most recent SetColor call). The mask
+// is not copied, so the caller must not change or free the array
+// while the renderer uses it as the pattern.
 bool AA4x8Renderer::SetPattern(const COLOR *pattern, float u0, float v0,
                                int w, int h, int stride, int flags)
 {
     if (_paintgen)
     {
-        _paintgen->~PaintGen();
+        delete _paintgen;
         _paintgen = 0;
     }
+    if (flags & FLAG_IMAGE_A8)
+    {
+        // Convert the solid color to premultiplied BGRA format. The
+        // paint generator samples the 8-bit mask values directly and
+        // mixes them into the color's alpha.
+        COLOR ga = _color & 0x0000ff00;
+        COLOR rb = _color & 0x00ff00ff;
+        COLOR color = PremultAlpha(ga | (rb >> 16) | (rb << 16) | (_color & 0xff000000));
+        TiledPattern *pat;
+        pat = CreateMaskPattern((const unsigned char*)pattern, color,
+                                u0, v0, w, h, stride, flags, _pxform);
+        if (pat == 0)
+        {
+            assert(pat != 0);
+            SetColor(_color);
+            return false;  // bad parameters or out of memory
+        }
+        _paintgen = pat;
+        _paintgen->SetScrollPosition(_xscroll, _yscroll);
+        BlendConstantAlphaLUT();  // fill look-up table with 8-bit alphas
+        return true;
+    }
     if (~flags & FLAG_IMAGE_BGRA32)
     {
         // This renderer requires BGRA (0xaarrggbb) pixel format
@@ -779,7 +1206,7 @@ bool AA4x8Renderer::SetPattern(ImageReader *imgrdr, float u0, float v0,
 {
     if (_paintgen)
     {
-        _paintgen->~PaintGen();
+        delete _paintgen;
         _paintgen = 0;
     }
     if (~flags & FLAG_IMAGE_BGRA32)
@@ -807,7 +1234,7 @@ bool AA4x8Renderer::SetLinearGradient(float x0, float y0, float x1, float y1,
 {
     if (_paintgen)
     {
-        _paintgen->~PaintGen();
+        delete _paintgen;
         _paintgen = 0;
     }
     LinearGradient *grad;
@@ -834,7 +1261,7 @@ bool AA4x8Renderer::SetRadialGradient(float x0, float y0, float r0,
 {
     if (_paintgen)
     {
-        _paintgen->~PaintGen();
+        delete _paintgen;
         _paintgen = 0;
     }
     RadialGradient *grad;
@@ -861,7 +1288,7 @@ bool AA4x8Renderer::SetConicGradient(float x0, float y0,
 {
     if (_paintgen)
     {
-        _paintgen->~PaintGen();
+        delete _paintgen;
         _paintgen = 0;
     }
     ConicGradient *grad;
@@ -915,6 +1342,20 @@ void AA4x8Renderer::SetTransform(const float xform[6])
         _pxform = 0;
 }
 
+// Public function: Copies the transformation matrix for patterns and
+// gradients to the 'xform' array, so that the caller can restore it
+// later by calling SetTransform. Returns false, and leaves the array
+// unchanged, if no transform is set (that is, the transform is the
+// identity matrix).
+bool AA4x8Renderer::GetTransform(float xform[6])
+{
+    if (_pxform == 0)
+        return false;
+
+    memcpy(&xform[0], &_xform[0], sizeof(_xform));
+    return true;
+}
+
 // Public function: Sets the blending operation that will be used to
 // blend source pixels with destination pixels
 void AA4x8Renderer::SetBlendOperation(BLENDOP blendop)
@@ -967,3 +1408,18 @@ EnhancedRenderer* CreateEnhancedRenderer(const PIXEL_BUFFER *pixbuf)
     return aarend;
 }
 
+// Creates a renderer for an 8-bit, alpha-only (A8) pixel buffer. The
+// 'depth' member of the PIXEL_BUFFER structure must be 8, and the
+// 'pitch' member is in bytes. If the 'pixels' member is null, the
+// renderer allocates the pixel memory, and pads each row to a
+// multiple of four bytes.
+EnhancedRenderer* CreateAlphaRenderer(const PIXEL_BUFFER *pixbuf)
+{
+    if (pixbuf->depth != 8)
+    {
+        assert(pixbuf->depth == 8);
+        return 0;  // bad parameter
+    }
+    return CreateEnhancedRenderer(pixbuf);
+}
+
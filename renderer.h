@@ -90,6 +90,7 @@ const int FLAG_IMAGE_BOTTOMUP = 4;
 const int FLAG_IMAGE_BGRA32 = 8;
 const int FLAG_SWAP_REDBLUE = 16;
 const int FLAG_PREMULTALPHA = 32;
+const int FLAG_IMAGE_A8 = 64;
 
 //---------------------------------------------------------------------
 //
@@ -98,7 +99,9 @@ const int FLAG_PREMULTALPHA = 32;
 // back buffer is passed as an argument to the constructor for a
 // BasicRenderer or EnhancedRenderer object. The renderer uses the
 // information in this struct to write directly to the back buffer,
-// which is then blitted to a window in on-screen memory.
+// which is then blitted to a window in on-screen memory. A buffer
+// with a depth of 8 bits per pixel contains 8-bit alpha values, which
+// a renderer created by CreateAlphaRenderer uses as a coverage mask.
 //
 //---------------------------------------------------------------------
 
@@ -127,7 +130,15 @@ bool DefineSubregion(PIXEL_BUFFER& subbuf, const PIXEL_BUFFER& buf, const SGRect
 // example, a bitmap file) to the specified 'buffer' array. The
 // return value is the number of pixels the function has copied,
 // which can be less than 'count' if the source supply of pixels is
-// low, or zero if the source is empty.
+// low, or zero if the source is empty. The GetImageName function
+// returns a name (for example, a file name) that uniquely identifies
+// the source image. If the name is not null, SetPattern keeps the
+// decoded image and reuses it for later patterns from the same
+// source, without calling ReadPixels again. The GetImageStamp
+// function gets the source's modification time and size (for
+// example, a file's time stamp and length in bytes). A kept image is
+// reused only if both values are unchanged, so a source that has been
+// rewritten is decoded again.
 //
 //---------------------------------------------------------------------
 
@@ -136,13 +147,19 @@ class ImageReader
 public:
     virtual int ReadPixels(COLOR *buffer, int count) = 0;
     virtual bool RewindData() = 0;
+    virtual const char* GetImageName() { return 0; }
+    virtual void GetImageStamp(long *mtime, long *size)
+    {
+        *mtime = *size = 0;
+    }
 };
 
 //---------------------------------------------------------------------
 //
 // A simple renderer: Fills a shape with a solid color, but does _NOT_
 // do antialiasing. This class is derived from the Renderer base class
-// in shapegen.h.
+// in shapegen.h. The Clear function sets every pixel in the pixel
+// buffer to the specified color, and ignores the clipping region.
 //
 //---------------------------------------------------------------------
 
@@ -150,6 +167,7 @@ class SimpleRenderer : public Renderer
 {
 public:
     virtual void SetColor(COLOR color) = 0;
+    virtual void Clear(COLOR color) = 0;
 };
 
 SimpleRenderer* CreateSimpleRenderer(const PIXEL_BUFFER *pixbuf);
@@ -185,11 +203,13 @@ public:
     virtual void AddColorStop(float offset, COLOR color) = 0;
     virtual void ResetColorStops() = 0;
     virtual void SetTransform(const float xform[6] = 0) = 0;
+    virtual bool GetTransform(float xform[6]) = 0;
     virtual void SetConstantAlpha(COLOR alpha = 255) = 0;
     virtual void SetBlendOperation(BLENDOP blendop = BLENDOP_SRC_OVER_DST) = 0;
 };
 
 EnhancedRenderer* CreateEnhancedRenderer(const PIXEL_BUFFER *pixbuf);
+EnhancedRenderer* CreateAlphaRenderer(const PIXEL_BUFFER *pixbuf);
 
 //-----------------------------------------------------------------------
 //
@@ -240,6 +260,13 @@ TiledPattern* CreateTiledPattern(ImageReader *imgrdr, float u0, float v0,
                                  int w, int h, int flags,
                                  const float xform[6] = 0);
 
+TiledPattern* CreateMaskPattern(const unsigned char *mask, COLOR color,
+                                float u0, float v0, int w, int h,
+                                int stride, int flags,
+                                const float xform[6] = 0);
+
+void SetPatternImageLimit(int maxbytes);
+
 // Paint generator for linear gradient fills
 //
 class LinearGradient : public PaintGen
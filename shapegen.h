@@ -68,6 +68,14 @@ const float FLATNESS_DEFAULT = 0.5;      // default flatness setting
 const float FLATNESS_MINIMUM = 0.2;      // minimum flatness setting
 const float FLATNESS_MAXIMUM = 100.0;    // maximum flatness setting
 
+// Curve culling margin, in pixels. A negative margin disables culling.
+const float CULLMARGIN_DEFAULT = -1.0;   // default = don't cull curves
+const float CULLMARGIN_MAXIMUM = 4096.0; // maximum culling margin
+
+// Path simplification tolerance, in pixels. Zero disables simplification.
+const float SIMPLIFY_DEFAULT = 0;        // default = don't simplify paths
+const float SIMPLIFY_MAXIMUM = 100.0;    // maximum simplification setting
+
 // SGCoord fixed-point fraction length -- bits to right of binary point
 const int FIXBITS_DEFAULT = 0;  // default = integer (no fixed point)
 
@@ -105,6 +113,31 @@ enum CLIPMODE {
 };
 const CLIPMODE CLIPMODE_DEFAULT = CLIPMODE_FILLPATH;
 
+// Internal representation of clipping region. An edge list clips
+// shapes exactly, but every fill must be merged with the clipping
+// region's edges. A coverage mask is rasterized once (with antialias-
+// ing) and then multiplied into the pixel coverage of each fill, so
+// its cost per fill doesn't depend on the complexity of the region.
+enum CLIPTYPE {
+    CLIPTYPE_AUTO,   // use mask if region has many edges
+    CLIPTYPE_EDGES,  // always use edge list
+    CLIPTYPE_MASK    // use coverage mask if renderer supports it
+};
+const CLIPTYPE CLIPTYPE_DEFAULT = CLIPTYPE_AUTO;
+
+// Method used to flatten Bezier curves. Subdivision adapts the lengths
+// of the line segments to the local curvature, but tests the flatness
+// of the curve at each level of subdivision. The uniform method uses
+// Wang's formula to calculate the number of segments needed to meet
+// the flatness tolerance, and then generates the points at equal
+// parameter steps by forward differencing. It typically generates a
+// few more segments, but is faster for paths that contain many curves.
+enum FLATTENMODE {
+    FLATTENMODE_SUBDIVIDE,  // recursive de Casteljau subdivision
+    FLATTENMODE_UNIFORM     // Wang's formula + forward differencing
+};
+const FLATTENMODE FLATTENMODE_DEFAULT = FLATTENMODE_SUBDIVIDE;
+
 // Flag bits for ShapeGen::GetBoundingBox function
 const int FLAG_BBOX_STROKE = 1;  // get bbox for stroked shape
 const int FLAG_BBOX_CLIP = 2;    // clip bbox to device clip rect
@@ -144,17 +177,43 @@ public:
 // rudimentary versions defined here. To enable pattern alignment, an
 // enhanced renderer implements its own version of the
 // SetScrollPosition function, but a renderer that does only solid-
-// color fills can inherit the version below.
+// color fills can inherit the version below. A renderer that supports
+// coverage-mask clipping implements its own versions of the
+// QueryClipMask and UpdateClipMask functions. The UpdateClipMask
+// function intersects the current mask with the interior or exterior
+// of the shape supplied by the feeder, or else resets, saves, or swaps
+// the mask. The function returns true if the current mask is not empty.
+// A renderer can implement its own version of the RenderRect function
+// to fill an axis-aligned rectangle directly, without a feeder. The
+// rectangle's x coordinates are 16.16 fixed-point values in the same
+// form as the x coordinates of the spans that a feeder supplies, and
+// its y coordinates are scan lines at the resolution specified by
+// QueryYResolution. If RenderRect returns false, ShapeGen fills the
+// rectangle through a feeder instead.
 //
 //---------------------------------------------------------------------
 
+// Operations performed by Renderer::UpdateClipMask function
+enum CLIPMASKOP {
+    CLIPMASK_INTERSECT,  // intersect mask with interior of shape
+    CLIPMASK_EXCLUDE,    // intersect mask with exterior of shape
+    CLIPMASK_RESET,      // discard current mask (no clipping)
+    CLIPMASK_INIT,       // discard current mask and saved mask
+    CLIPMASK_SAVE,       // save a copy of the current mask
+    CLIPMASK_SWAP        // swap current mask with saved mask
+};
+
 class Renderer
 {
 public:
+    virtual ~Renderer() {}
     virtual void RenderShape(ShapeFeeder *feeder) = 0;
     virtual int QueryYResolution() { return 0; }
     virtual bool SetMaxWidth(int width) { return true; }
     virtual bool SetScrollPosition(int x, int y) { return true; }
+    virtual bool QueryClipMask() { return false; }
+    virtual bool UpdateClipMask(CLIPMASKOP op, ShapeFeeder *feeder = 0) { return false; }
+    virtual bool RenderRect(const SGRect *rect) { return false; }
 };
 
 //---------------------------------------------------------------------
@@ -185,11 +244,17 @@ public:
     virtual void Move(SGCoord x, SGCoord y) = 0;
     virtual bool Line(SGCoord x, SGCoord y) = 0;
     virtual bool PolyLine(const SGPoint xy[], int npts) = 0;
+    virtual bool PolyLineDecimated(const SGPoint xy[], int npts) = 0;
     virtual void Rectangle(const SGRect& rect) = 0;
 
     // Basic path attributes
     virtual float SetFlatness(float tol = FLATNESS_DEFAULT) = 0;
+    virtual FLATTENMODE SetFlattenMode(FLATTENMODE mode = FLATTENMODE_DEFAULT) = 0;
+    virtual float SetCullMargin(float margin = CULLMARGIN_DEFAULT) = 0;
+    virtual float SetSimplify(float tol = SIMPLIFY_DEFAULT) = 0;
     virtual int SetFixedBits(int nbits = FIXBITS_DEFAULT) = 0;
+    virtual void SetPathTransform(const float xform[6] = 0) = 0;
+    virtual bool GetPathTransform(float xform[6]) = 0;
     virtual void SetScrollPosition(int x = 0, int y = 0) = 0;
     virtual bool GetCurrentPoint(SGPoint *cpoint = 0) = 0;
     virtual bool GetFirstPoint(SGPoint *fpoint = 0) = 0;
@@ -202,10 +267,12 @@ public:
     virtual bool SetMaskRegion(CLIPMODE clipmode = CLIPMODE_DEFAULT) = 0;
     virtual bool SaveClipRegion() = 0;
     virtual bool SwapClipRegion() = 0;
+    virtual CLIPTYPE SetClipType(CLIPTYPE cliptype = CLIPTYPE_DEFAULT) = 0;
 
     // Rendering of filled paths and stroked paths
     virtual bool FillPath() = 0;
     virtual bool StrokePath() = 0;
+    virtual void FillRects(const SGRect rects[], int n) = 0;
 
     // Attributes of filled paths and stroked paths
     virtual FILLRULE SetFillRule(FILLRULE fillrule = FILLRULE_DEFAULT) = 0;
@@ -228,6 +295,11 @@ public:
     virtual bool PolyBezier2(const SGPoint xy[], int npts) = 0;
     virtual bool Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3) = 0;
     virtual bool PolyBezier3(const SGPoint xy[], int npts) = 0;
+
+    // Paths specified by arrays of floating-point x-y coordinates
+    virtual bool PolyLineF(const float xy[], int npts) = 0;
+    virtual bool PolyBezier3F(const float xy[], int npts) = 0;
+    virtual bool BezierFigureF(const float xy[], int npts, bool bclosed) = 0;
 };
 
 //---------------------------------------------------------------------
@@ -62,6 +62,13 @@ struct XY {
     float y;
 };
 
+// Rounds a floating-point value to the nearest integer. Used to
+// convert a value that is scaled to 16.16 fixed-point units to FIX16.
+inline FIX16 RoundFix(float x)
+{
+    return (x < 0) ? FIX16(x - 0.5f) : FIX16(x + 0.5f);
+}
+
 const int BIGVAL16 = 0x7FFF;  // biggest 16-bit signed integer value
 
 // Miscellaneous constants in 16.16 internal fixed-point format
@@ -74,6 +81,9 @@ const FIX16 FIX_BIAS = 0x7FFF;  // (1/2-1/65536) in fixed-point format
 const int KMAX = 6;        // max k for ellipse angular increment 1/2^k
 const int MAXLEVELS = 12;  // max number bezier subdivision levels
 
+// Max depth of the split stack used to simplify a figure
+const int SIMPLIFY_MAXDEPTH = 64;
+
 // Structure used to describe a figure (aka subpath or contour)
 struct FIGURE {
     bool isclosed;  // true if figure is closed
@@ -89,6 +99,13 @@ struct EDGE {
     FIX16 dxdy;  // inverse slope: change in x per unit step in y
 };
 
+// Structure used to describe a line segment in a stroked figure
+struct SEGMENT {
+    XY u;        // unit vector in direction of line segment
+    VERT16 a;    // vector of length _linewidth/2 in direction u
+    FIX16 len;   // length of line segment in 16.16 fixed-point format
+};
+
 // Singly linked list of edges
 struct EDGELIST {
     EDGE *head;
@@ -105,6 +122,10 @@ struct EDGELIST {
 const FILLRULE FILLRULE_INTERSECT = FILLRULE(FILLRULE_WINDING + 1);
 const FILLRULE FILLRULE_EXCLUDE = FILLRULE(FILLRULE_INTERSECT + 1);
 
+// In CLIPTYPE_AUTO mode, a clipping region with at least this many
+// edges is converted to a coverage mask (if the renderer supports it)
+const int CLIPMASK_MIN_EDGES = 2048;
+
 // Length of initial path stack memory allocation
 const int INITIAL_PATH_LENGTH = 2000;
 
@@ -139,6 +160,12 @@ public:
     ~POOL();
     void Reset();
     EDGE* Allocate(EDGE *p = 0);
+    EDGE* Reserve(int *len);
+    void Commit(int len)
+    {
+        assert(0 <= len && watermark + len <= blklen);
+        watermark += len;
+    }
     int GetCount()
     {
         return (count + watermark);
@@ -164,7 +191,15 @@ class EdgeMgr
     Renderer *_renderer;
     int _yshift, _ybias, _yhalf;
 
+    // Device clipping rectangle for culling new edges
+    SGRect _cullrect;           // rectangle in path coordinates
+    bool _bCull;                // true if culling is enabled
+    FIX16 _cullxmin, _cullxmax; // left and right sides (16.16)
+    int _cullytop, _cullybot;   // top and bottom scan lines
+
     void SaveEdgePair(int height, EDGE *edgeL, EDGE *edgeR);
+    void UpdateCullBounds();
+    bool NormalizeMonotoneEdges();
 
 protected:
     EdgeMgr();
@@ -174,10 +209,15 @@ protected:
     void ReverseEdges();
     void ClipEdges(FILLRULE fillrule);
     bool FillEdgeList();
+    bool SetClipMask(CLIPMASKOP op);
+    int CountEdges();
     void NormalizeEdges(FILLRULE fillrule);
     void AttachEdge(const VERT16 *v1, const VERT16 *v2);
+    void AttachEdges(const VERT16 *pts, int npts, bool bclosed);
     void TranslateEdges(int x, int y);
+    void SetCullRectangle(const SGRect *rect);
     void SetDeviceClipRectangle(int width, int height, bool bsave);
+    bool FillRectangle(const VERT16 *vmin, const VERT16 *vmax);
     bool SaveClipRegion();
     bool SwapClipRegion();
 };
@@ -199,13 +239,32 @@ class PathMgr : virtual public ShapeGen
     EdgeMgr *_edge;      // manages lists of polygonal edges
     SGRect _devicecliprect;  // clipping rectangle for display device
     FIX16 _flatness;     // error tolerance for flattened arcs/curves
+    FLATTENMODE _flattenmode;  // method used to flatten Bezier curves
+    FIX16 _cullmargin;   // curve culling margin (negative = disabled)
+    VERT16 _cullmin;     // top-left corner of curve culling rectangle
+    VERT16 _cullmax;     // bottom-right corner of culling rectangle
+    FIX16 _simplify;     // path simplification tolerance (0 = disabled)
+    VERT16 _arcvec[2];   // vectors P and Q from last AngularInc call
+    FIX16 _arcflat;      // flatness at last AngularInc call
+    int _arcinc;         // result of last AngularInc call
     int _fixshift;       // to convert user coords to 16.16 fixed-point
+    bool _bXform;        // true if path transform is not identity
+    float _xform[6];     // path transform (user to device coords)
+    float _xfmat[4];     // _xform[0..3] scaled to convert to 16.16
+    FIX16 _xfoff[2];     // _xform[4..5] in 16.16 fixed-point format
     FILLRULE _fillrule;  // either even-odd or nonzero winding number
+    CLIPTYPE _cliptype;  // clipping region representation
+    bool _bClipMask;     // true if renderer has clipping mask
+    bool _bSaveMask;     // true if renderer has saved clipping mask
 
     // Storage for points in path
     int _pathlength;  // current length of path array
     VERT16 *_path;    // pointer to dynamically allocated path array
 
+    // Storage for line segments in the figure being stroked
+    int _seglength;   // current length of segment array
+    SEGMENT *_seg;    // pointer to dynamically allocated segment array
+
     // Path memory management functions
     void GrowPath();
     void PathCheck(VERT16 *ptr)
@@ -236,8 +295,32 @@ class PathMgr : virtual public ShapeGen
     float _mitercheck;  // precomputed parameter for miter-limit check
     FIX16 _angle;       // angle between line segments at round join
     FIX16 _joinhint;    // hint for approximating round/miter join
+    FIX16 _miterhint;   // hint for joining sides at a single point
+    int _joininc;       // angular increment exponent for round joins
 
     void FinalizeFigure(bool bclose);  // closes or ends a figure
+    void UpdateCullRect();  // updates curve culling rectangle
+    void UpdateJoinHint();  // updates hints for approximating joins
+    VERT16* SimplifyFigure(VERT16 *first, VERT16 *last);
+    void AppendColumn(const VERT16 vert[5], const int index[5]);
+
+    // Converts user coordinates to transformed 16.16 fixed-point
+    void UserToDevice(VERT16 *v, SGCoord x, SGCoord y)
+    {
+        if (_bXform)
+        {
+            float fx = x, fy = y;
+            v->x = _xfoff[0] + RoundFix(_xfmat[0]*fx + _xfmat[2]*fy);
+            v->y = _xfoff[1] + RoundFix(_xfmat[1]*fx + _xfmat[3]*fy);
+        }
+        else
+        {
+            v->x = x << _fixshift;
+            v->y = y << _fixshift;
+        }
+    }
+    void UserToDevice(VERT16 dst[], const SGPoint src[], int npts);
+    void FloatToDevice(VERT16 dst[], const float src[], int npts);
 
 protected:
     PathMgr(Renderer *renderer, const SGRect& cliprect);
@@ -256,11 +339,17 @@ public:
     void Move(SGCoord x, SGCoord y);
     bool Line(SGCoord x, SGCoord y);
     bool PolyLine(const SGPoint xy[], int npts);
+    bool PolyLineDecimated(const SGPoint xy[], int npts);
     void Rectangle(const SGRect& rect);
 
     // Basic path attributes
     float SetFlatness(float tol);
+    FLATTENMODE SetFlattenMode(FLATTENMODE mode);
+    float SetCullMargin(float margin);
+    float SetSimplify(float tol);
     int SetFixedBits(int nbits);
+    void SetPathTransform(const float xform[6]);
+    bool GetPathTransform(float xform[6]);
     void SetScrollPosition(int x, int y);
     bool GetCurrentPoint(SGPoint *cpoint);
     bool GetFirstPoint(SGPoint *fpoint);
@@ -271,18 +360,14 @@ public:
     void ResetClipRegion();
     bool SetClipRegion(CLIPMODE clipmode);
     bool SetMaskRegion(CLIPMODE clipmode);
-    bool SaveClipRegion()
-    {
-        return _edge->SaveClipRegion();
-    }
-    bool SwapClipRegion()
-    {
-        return _edge->SwapClipRegion();
-    }
+    bool SaveClipRegion();
+    bool SwapClipRegion();
+    CLIPTYPE SetClipType(CLIPTYPE cliptype);
 
     // Rendering of filled and stroked shapes
     bool FillPath();
     bool StrokePath();
+    void FillRects(const SGRect rects[], int n);
 
     // Attributes for filling and stroking paths
     FILLRULE SetFillRule(FILLRULE fillrule);
@@ -297,9 +382,12 @@ private:
     bool FilledShape();  // convert path to edge list for filled shape
     bool StrokedShape(); // convert path to edge list for stroked shape
     bool InitLineDash();
+    bool UseClipMask();  // use coverage mask instead of edge list?
     FIX16 LineLength(const VERT16& vs, const VERT16& ve, XY *u, VERT16 *a);
+    bool MeasureSegments(const VERT16 *vs, int nlines);
     void RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2);
-    void JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout);
+    void JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout,
+                   FIX16 seglen);
     void DashedLine(const VERT16& ve, const XY& u, const VERT16& a, FIX16 linelen);
     bool ThinStroke();
     void JoinThinLines(const VERT16 *vert, int inquad, int outquad);
@@ -315,7 +403,8 @@ public:
 private:
     // Internal functions to flatten ellipses and elliptic arcs
     void EllipseCore(FIX16 xC, FIX16 yC, FIX16 xP, FIX16 yP,
-                     FIX16 xQ, FIX16 yQ, FIX16 sweep);
+                     FIX16 xQ, FIX16 yQ, FIX16 sweep, int k = -1);
+    void EllipticSplineCore(const VERT16& v1, const VERT16& v2);
     int AngularInc(FIX16 xP, FIX16 yP, FIX16 xQ, FIX16 yQ);
 
 public:
@@ -325,8 +414,18 @@ public:
     bool Bezier3(const SGPoint& v1, const SGPoint& v2, const SGPoint& v3);
     bool PolyBezier3(const SGPoint xy[], int npts);
 
+    // Paths specified by arrays of floating-point x-y coordinates
+    bool PolyLineF(const float xy[], int npts);
+    bool PolyBezier3F(const float xy[], int npts);
+    bool BezierFigureF(const float xy[], int npts, bool bclosed);
+
 private:
-    // Internal functions for checking flatness of splines
+    // Internal functions for flattening splines
+    bool IsCulled(const VERT16 v[], int npts);
+    void Bezier2Core(const VERT16& v1, const VERT16& v2);
+    void Bezier3Core(const VERT16& v1, const VERT16& v2, const VERT16& v3);
+    void Bezier2Uniform(const VERT16& v1, const VERT16& v2);
+    void Bezier3Uniform(const VERT16& v1, const VERT16& v2, const VERT16& v3);
     bool IsFlatQuadratic(const VERT16 v[3]);
     bool IsFlatCubic(const VERT16 v[4]);
 };
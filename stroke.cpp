@@ -110,12 +110,35 @@ float PathMgr::SetLineWidth(float width)
         return 0;
     }
     _linewidth = 65536*width;  // convert to 16.16 fixed-point format
+    UpdateJoinHint();
+    return oldwidth;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Updates the angular increment used to construct
+// round joins and caps, and the two hints that help JoinLines() decide
+// when a round or miter join is small and flat enough to be
+// approximated. The hints depend on the line width and the flatness,
+// and are updated when either of these changes. Each hint is a
+// threshold for the dot product of the two half-width vectors that
+// JoinLines() receives. If the dot product exceeds _joinhint, the join
+// is approximated as a bevel join. If the dot product exceeds
+// _miterhint, a round or miter join is reduced to a single point on
+// each side of the stroke, and the point on the outside of the join
+// overshoots a round join by no more than the flatness. Neither hint
+// allows the directions of the two line segments to diverge by more
+// than 60 degrees.
+//
+//---------------------------------------------------------------------
 
-    // This hint helps JoinLines() determine when a round or miter join
-    // is small and flat enough to be approximated as a bevel join
+void PathMgr::UpdateJoinHint()
+{
     const float cos30 = 0.8660254037f, cos60 = 0.5f;
     const float limit = 0.5*(1 - cos30*cos30)/cos30;
-    float cosaa, ratio = FLATNESS_DEFAULT/width;
+    float width = _linewidth/65536.0f;
+    float flatness = _flatness/65536.0f;
+    float cosaa, cosmm, ratio = flatness/width;
     if (ratio < limit)
     {
         float cosa = sqrt(1 + ratio*ratio) - ratio;
@@ -127,7 +150,20 @@ float PathMgr::SetLineWidth(float width)
         cosaa = cos60;
 
     _joinhint = (65536/4)*width*width*cosaa;
-    return oldwidth;
+
+    // The miter point lies width/2/cos(aa/2) from the vertex, where aa
+    // is the angle between the two line segments
+    float cosm = width/(width + 2*flatness);
+    cosmm = max(2*cosm*cosm - 1, cos60);
+    _miterhint = (65536/4)*width*width*cosmm;
+
+    // Every round join and cap is an arc of the same circle, so its
+    // angular increment is calculated just once, for a radius vector
+    // that's aligned with the x axis. For other alignments, AuxRadius
+    // overestimates the radius a little more, which might have
+    // selected a smaller increment, but the flatness is still met.
+    FIX16 radius = _linewidth/2;
+    _joininc = AngularInc(radius, 0, 0, radius);
 }
 
 //---------------------------------------------------------------------
@@ -347,6 +383,59 @@ FIX16 PathMgr::LineLength(const VERT16& vs, const VERT16& ve, XY *u, VERT16 *a)
     return length;
 }
 
+//---------------------------------------------------------------------
+//
+// Private function: Calculates the length and direction of each line
+// segment in a figure that is about to be stroked, and stores them in
+// the _seg array. Parameter vs points to the first point in the
+// figure, and nlines is the number of line segments. The results are
+// the same as those of the LineLength function, but calculating them
+// in a separate pass keeps this loop free of function calls and
+// branches, so that the compiler can vectorize it, and leaves the
+// join and cap logic in StrokedShape to read them from the array. The
+// function returns false if the _seg array can't be allocated.
+//
+//----------------------------------------------------------------------
+
+bool PathMgr::MeasureSegments(const VERT16 *vs, int nlines)
+{
+    if (nlines > _seglength)
+    {
+        int len = max(nlines, 2*_seglength);
+
+        delete[] _seg;
+        _seg = new SEGMENT[len];
+        if (_seg == 0)
+        {
+            assert(_seg != 0);
+            _seglength = 0;
+            return false;  // fail - out of memory
+        }
+        _seglength = len;
+    }
+
+    // Copy members to locals so that stores to the array can't alias them
+    const float width = _linewidth;
+    SEGMENT *seg = _seg;
+
+    for (int i = 0; i < nlines; ++i)
+    {
+        float dx = vs[i+1].x - vs[i].x;
+        float dy = vs[i+1].y - vs[i].y;
+        float len = sqrt(dx*dx + dy*dy);
+        float div = len + (len == 0);  // if len = 0, so do dx and dy
+        float ux = dx/div;
+        float uy = dy/div;
+
+        seg[i].u.x = ux;
+        seg[i].u.y = uy;
+        seg[i].a.x = ux*width/2;
+        seg[i].a.y = uy*width/2;
+        seg[i].len = len;
+    }
+    return true;
+}
+
 //---------------------------------------------------------------------
 //
 // Private function: Constructs a stroked line segment in accordance
@@ -472,8 +561,7 @@ void PathMgr::DashedLine(const VERT16& ve, const XY& u, const VERT16& a, FIX16 l
 
 void PathMgr::RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2)
 {
-    VERT16 *p, *q, v1, v2;
-    int count;
+    VERT16 v1, v2;
 
     // Path should be properly terminated with empty figure
     assert(_cpoint == 0);
@@ -495,7 +583,7 @@ void PathMgr::RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2)
 
     // The EllipseCore function call calculates the points in
     // the arc, adds them to the path, and updates _cpoint
-    EllipseCore(v0.x, v0.y, v1.x, v1.y, a1.x, a1.y, _angle);
+    EllipseCore(v0.x, v0.y, v1.x, v1.y, a1.x, a1.y, _angle, _joininc);
 
     // Add arc's ending point to temporary path buffer
     PathCheck(++_cpoint);
@@ -503,10 +591,7 @@ void PathMgr::RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2)
     _cpoint->y = v0.y + v2.y;
 
     // Convert points in path to polygonal edges
-    p = q = _fpoint;
-    count = _cpoint - _fpoint;
-    for (int i = 0; i < count; ++i)
-        _edge->AttachEdge(p++, ++q);
+    _edge->AttachEdges(_fpoint, _cpoint - _fpoint + 1, false);
 
     // Restore temp buffer on path stack to empty state
     _cpoint = 0;
@@ -518,12 +603,14 @@ void PathMgr::RoundJoin(const VERT16& v0, const VERT16& a1, const VERT16& a2)
 // is the vertex at which the two line segments are joined. Parameters
 // 'ain' and 'aout' are vectors of length _linewidth/2 that point in
 // the directions of the incoming and outgoing line segments,
-// respectively. Member variables _vin and _vout are the starting and
-// ending points for the stroked edges of the incoming line segment.
+// respectively. Parameter seglen is the length of the shorter of the
+// two line segments. Member variables _vin and _vout are the starting
+// and ending points for the stroked edges of the incoming line segment.
 //
 //----------------------------------------------------------------------
 
-void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
+void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout,
+                        FIX16 seglen)
 {
     const FIX16 dotprod = ((float)ain.x*aout.x + (float)ain.y*aout.y)/65536;
     VERT16 v1, v2, v3, v4;
@@ -540,22 +627,65 @@ void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
     v4.x -= aout.y;
     v4.y += aout.x;
 
+    // Special case: If a round or miter join is flat enough, extend the
+    // sides of the incoming and outgoing stroked segments until they
+    // meet. This adds only one vertex to each side of the stroke. The
+    // outside vertex is the miter point, so a miter join qualifies only
+    // if it is within the miter limit (the same test as in the general
+    // case below); otherwise, the join is beveled, and the miter point
+    // would overshoot the bevel. A bevel join never qualifies. The
+    // inside vertex lies behind v0 along each line segment. The joins
+    // at both ends of a segment set back along it, so the inside vertex
+    // is used only if it lies within half the length of the shorter
+    // line segment, and the side of the stroke can't double back on
+    // itself. A dash might start or end near the join, so this case
+    // doesn't apply to dashed lines.
+
+    if (dotprod > _miterhint && _pdash == 0 && _linejoin != LINEJOIN_BEVEL &&
+        (_linejoin == LINEJOIN_ROUND ||
+         abs(ain.x - aout.x) + abs(ain.y - aout.y) <=
+         _mitercheck*(abs(ain.x + aout.x) + abs(ain.y + aout.y))))
+    {
+        const float hw2 = (float)_linewidth*_linewidth/(4*65536);
+        const float xprod = ((float)ain.x*aout.y - (float)ain.y*aout.x)/65536;
+        float scale = hw2/(hw2 + dotprod);
+
+        if (fabs(xprod)*_linewidth < seglen*(hw2 + dotprod))
+        {
+            VERT16 vm1 = v0, vm2 = v0;
+            FIX16 dx = scale*(ain.y + aout.y);
+            FIX16 dy = scale*(ain.x + aout.x);
+
+            vm1.x += dx;
+            vm1.y -= dy;
+            vm2.x -= dx;
+            vm2.y += dy;
+            _edge->AttachEdge(&_vin, &vm1);
+            _edge->AttachEdge(&vm2, &_vout);
+            _vin = vm1;
+            _vout = vm2;
+            return;  // end special case
+        }
+    }
+
     // Special case: Frequently, if two short line segments are joined
     // together along an arc or curve, they point in nearly the same
     // direction. In such cases, a round join or a miter join is
     // indistinguishable from a simple bevel join, and we can avoid a
     // lot of unnecessary calculation. The bevel-join approximation
-    // below is used if (1) the geometric error is less than 1/2 pixel
-    // (the default flatness) and (2) the directions of the incoming
-    // and outgoing line segments diverge by less than 60 degrees.
-    // Condition (2) affects only line widths of less than 3.5 pixels.
+    // below is used if (1) the geometric error is less than the
+    // flatness (1/2 pixel by default) and (2) the directions of the
+    // incoming and outgoing line segments diverge by less than 60
+    // degrees. At the default flatness, condition (2) affects only
+    // line widths of less than 3.5 pixels.
 
     if (dotprod > _joinhint)
     {
-        _edge->AttachEdge(&_vin, &v1);
-        _edge->AttachEdge(&v2, &_vout);
-        _edge->AttachEdge(&v1, &v3);
-        _edge->AttachEdge(&v4, &v2);
+        VERT16 side1[3] = { _vin, v1, v3 };
+        VERT16 side2[3] = { v4, v2, _vout };
+
+        _edge->AttachEdges(side1, 3, false);
+        _edge->AttachEdges(side2, 3, false);
         _vin = v3;
         _vout = v4;
         return;  // end special case
@@ -570,14 +700,14 @@ void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
     if (xprod < 0)
     {
         // Stroke turns left (CCW) at join
-        _edge->AttachEdge(&v1, &v0);
-        _edge->AttachEdge(&v0, &v3);
+        VERT16 inside[3] = { v1, v0, v3 };
+        _edge->AttachEdges(inside, 3, false);
     }
     else
     {
         // Stroke turns right (CW) at join
-        _edge->AttachEdge(&v4, &v0);
-        _edge->AttachEdge(&v0, &v2);
+        VERT16 inside[3] = { v4, v0, v2 };
+        _edge->AttachEdges(inside, 3, false);
     }
     // Check for bevel or round line join
     if (_linejoin == LINEJOIN_BEVEL || _linejoin == LINEJOIN_ROUND)
@@ -745,7 +875,10 @@ void PathMgr::JoinLines(const VERT16& v0, const VERT16& ain, const VERT16& aout)
 // line segments are offset by _linewidth/2 from the segments defined
 // in the original path. Joins are constructed to connect the sides of
 // adjoining stroked segments, and any open line ends are capped. Then
-// the segments in the stroked path are added to the edge list.
+// the segments in the stroked path are added to the edge list. Each
+// figure is processed in two passes: MeasureSegments calculates the
+// lengths and directions of all the line segments in the figure, and
+// then the joins and caps are constructed from these values.
 //
 //----------------------------------------------------------------------
 
@@ -771,18 +904,26 @@ bool PathMgr::StrokedShape()
         XY uin, uout, u0;  // unit vector in line direction
         VERT16 ain, aout;  // vectors of length = _linewidth/2
         FIX16 linelen;     // length of current line segment
+        FIX16 len0, lenin; // lengths of first and previous segments
         VERT16 *fpt = reinterpret_cast<VERT16*>(_figtmp + 1);
         VERT16 *vs = &fpt[-offset];  // start of 1st line segment
         VERT16 *ve = &vs[1];    // end of 1st line segment
         int nlines = offset - 2;  // number of line segments
+        const SEGMENT *seg;     // current line segment
 
         assert(vs != ve);  // figure has at least 2 points
         _figtmp = &_figtmp[-offset];  // point to header for new figure
+        if (MeasureSegments(vs, nlines) == false)
+            break;  // out of memory
 
+        seg = _seg;
         vs0 = vs;  // save starting point
-        linelen = LineLength(*vs, *ve, &uin, &ain);
+        linelen = seg->len;
+        uin = seg->u;
+        ain = seg->a;
         u0 = uin;  // save starting direction
         a0 = ain;
+        len0 = linelen;
 
         // Offset stroked edges _linewidth/2 from initial line segment
         if (dashon0)
@@ -802,13 +943,17 @@ bool PathMgr::StrokedShape()
         vs = ve++;
         while (--nlines > 0)
         {
-            linelen = LineLength(*vs, *ve, &uout, &aout);
+            ++seg;
+            lenin = linelen;
+            linelen = seg->len;
+            uout = seg->u;
+            aout = seg->a;
             if (_dashon)
             {
                 if (_linejoin == LINEJOIN_ROUND)
                     _angle = GetAngle(uin, uout);
 
-                JoinLines(*vs, ain, aout);
+                JoinLines(*vs, ain, aout, min(lenin, linelen));
             }
             if (_pdash != 0)
                 DashedLine(*ve, uout, aout, linelen);
@@ -825,7 +970,7 @@ bool PathMgr::StrokedShape()
             if (_linejoin == LINEJOIN_ROUND)
                 _angle = GetAngle(uin, u0);
 
-            JoinLines(*vs0, ain, a0);
+            JoinLines(*vs0, ain, a0, min(linelen, len0));
             _edge->AttachEdge(&_vin, &vin0);
             _edge->AttachEdge(&vout0, &_vout);
         }
@@ -111,7 +111,7 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
     SmartPtr<EnhancedRenderer> aarend(CreateEnhancedRenderer(&bkbuf));
     SmartPtr<ShapeGen> sg(CreateShapeGen(&(*aarend), cliprect));
     NSVGimage* image;
-    float scale, scale16;
+    float scale;
     UserMessage umsg;
 
     if (_argc_ < 2)
@@ -156,36 +156,38 @@ int RunTest(int testnum, const PIXEL_BUFFER& bkbuf, const SGRect& cliprect)
     else
         scale = 1;  // we'll honor the viewport defined in the SVG file
 
-    scale16 = 65536*scale;  // to scale 16.16 fixed-point SGCoord values
-    sg->SetFixedBits(16);
+    float xform[6] = { scale, 0, 0, scale, 0, 0 };
+    sg->SetPathTransform(xform);
+    sg->SetFlattenMode(FLATTENMODE_UNIFORM);  // SVG paths are all curves
 
     // Render the image data
     for (NSVGshape *shape = image->shapes; shape != NULL; shape = shape->next)
     {
-        // Construct the path -- push shape coordinates onto path stack
-        sg->BeginPath();
-        for (NSVGpath *path = shape->paths; path != NULL; path = path->next)
+        // Curves that lie entirely outside the window (plus the width
+        // of any stroke drawn along them) are replaced by their chords.
+        // Dashes and clipped miters disable culling.
+        float margin = 0;
+        if (shape->stroke.type != NSVG_PAINT_NONE)
         {
-            float* p = &path->pts[0];
-            SGPoint v[4];
-
-            // if primitive == cubic bezier, then...
-            v[0].x = scale16*p[0], v[0].y = scale16*p[1];
-            sg->Move(v[0].x, v[0].y);
-            for (int i = 0; i < path->npts-1; i += 3)
+            if (shape->strokeDashCount != 0 ||
+                shape->strokeLineJoin == NSVG_JOIN_MITERCLIP)
+                margin = -1;
+            else
             {
-                p = &path->pts[i*2];
-                v[1].x = scale16*p[2];
-                v[1].y = scale16*p[3];
-                v[2].x = scale16*p[4];
-                v[2].y = scale16*p[5];
-                v[3].x = scale16*p[6];
-                v[3].y = scale16*p[7];
-                sg->Bezier3(v[1], v[2], v[3]);
+                float mlim = 1.5;  // covers round joins and square caps
+                if (shape->strokeLineJoin == NSVG_JOIN_MITER &&
+                    shape->miterLimit > mlim)
+                    mlim = shape->miterLimit;
+
+                margin = 0.5*mlim*scale*shape->strokeWidth + 1;
             }
-            if (path->closed)
-                sg->CloseFigure();
         }
+        sg->SetCullMargin(margin);
+
+        // Construct the path -- push shape coordinates onto path stack
+        sg->BeginPath();
+        for (NSVGpath *path = shape->paths; path != NULL; path = path->next)
+            sg->BezierFigureF(path->pts, path->npts, path->closed != 0);
 
         // If fill paint is specified, fill the path
         int alpha = shape->opacity*255.99;
@@ -42,10 +42,28 @@ struct GLYPH
     int charcode;  // character code for this glyph
     int xyindex;   // glyph's starting index into xytbl array
     int xylen;     // number of xytbl elements for this glyph
-    SGPoint *xy;   // transformed glyph x-y coords in 16.16 fixed point
-    char *displist;  // string containing glyph display list
+    float advance; // advance width, not including the bearings
+    const char *displist;  // string containing glyph display list
 };
 
+// A cached glyph mask contains the 8-bit AA coverage values for a glyph
+// that was stroked at a particular scale and stroke width, and with
+// its starting x coordinate at a particular subpixel offset
+struct GLYPHMASK
+{
+    int charcode;     // character code for this glyph
+    float scale;      // scaling factor applied to glyph
+    float width;      // stroke width
+    int subx;         // subpixel x offset (in quarter pixels)
+    int x0, y0;       // mask's top-left corner relative to pen position
+    int w, h;         // width and height of mask in pixels
+    unsigned char *mask;  // coverage values (w*h bytes)
+    GLYPHMASK *next;  // next mask in same hash chain
+};
+
+// Number of subpixel x offsets in glyph mask cache
+const int GLYPHMASK_SUBPIXELS = 4;
+
 // Display list verbs
 #define MOVE                "\x1"
 #define LINE                "\x2"
@@ -71,6 +89,11 @@ const int _DRAWADOT_           = 0x9;
 const float leftbearing = 8.0;
 const float rightbearing = 8.0;
 
+// Range of character codes in glyph table. The last glyph is the
+// default symbol for unimplemented characters.
+const int GLYPH_FIRSTCHAR = 0x20;
+const int GLYPH_LASTCHAR = 0x7f;
+
 //---------------------------------------------------------------------
 //
 // The xytbl array contains the points that define the shapes of all
@@ -1057,846 +1080,842 @@ const XY xytbl[] = {
 
 //---------------------------------------------------------------------
 //
-// Each string in the displaylist array element is a display list for
-// a glyph. The first byte in each string is the character code for
-// the glyph. The second byte is the number of xytbl array elements
-// used to construct the glyph. The remaining bytes are interpreted by
-// the DrawGlyph function to draw the glyph on the display.
+// The glyphtbl array contains an entry for each glyph, in order of
+// increasing character code. Each entry specifies the character code,
+// the glyph's starting index into the xytbl array, the number of xytbl
+// elements used to construct the glyph, the glyph's advance width (not
+// including the bearings), and the glyph's display list. The display
+// list string is interpreted by the DrawGlyph function to draw the
+// glyph on the display. Because this table is constant data, it is
+// initialized at compile time, and a TextApp object doesn't need to
+// build any font data structures at run time.
 //
 //---------------------------------------------------------------------
 
-char *displaylist[] = {
+const GLYPH glyphtbl[] = {
 
 // glyph ' '  (blank space)
 
-    " "  "\x2"         // 2 points for this glyph
-    ,                  // end of display list for this glyph
+    { ' ', 0, 2, 16.000,
+      ""
+    },
 
 // glyph '!'
 
-    "!"  "\x5"         // 5 points for this glyph
-    DRAWADOT "\x2"
-    MOVE "\x3"
-    LINE "\x4"
-    ,                  // end of display list for this glyph
+    { '!', 2, 5, 4.000,
+      DRAWADOT "\x2"
+      MOVE "\x3"
+      LINE "\x4"
+    },
 
 // glyph '\"'
 
-    "\""  "\x6"        // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    ,                  // end of display list for this glyph
+    { '\"', 7, 6, 20.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+    },
 
 // glyph '#'
 
-    "#"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    MOVE "\x6"
-    LINE "\x7"
-    MOVE "\x8"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { '#', 13, 10, 49.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+      MOVE "\x6"
+      LINE "\x7"
+      MOVE "\x8"
+      LINE "\x9"
+    },
 
 // glyph '$'
 
-    "$"  "\x11"         // 17 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\xc\x3"
-    MOVE "\xf"
-    LINE "\x10"
-    ,                  // end of display list for this glyph
+    { '$', 23, 17, 32.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\xc\x3"
+      MOVE "\xf"
+      LINE "\x10"
+    },
 
 // glyph '%'
 
-    "%"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ELLIPSE "\x4\x5\x6"
-    ELLIPSE "\x7\x8\x9"
-    ,                  // end of display list for this glyph
+    { '%', 40, 10, 60.000,
+      MOVE "\x2"
+      LINE "\x3"
+      ELLIPSE "\x4\x5\x6"
+      ELLIPSE "\x7\x8\x9"
+    },
 
 // glyph '&'
 
-    "&"  "\x17"         // 23 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x14\x3"
-    ,                  // end of display list for this glyph
+    { '&', 50, 23, 46.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x14\x3"
+    },
 
 // glyph '\''
 
-    "\'"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { '\'', 73, 4, 8.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph '('
 
-    "("  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x4\x3"
-    ,                  // end of display list for this glyph
+    { '(', 77, 7, 14.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x4\x3"
+    },
 
 // glyph ')'
 
-    ")"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x4\x3"
-    ,                  // end of display list for this glyph
+    { ')', 84, 7, 14.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x4\x3"
+    },
 
 // glyph '*'
 
-    "*"  "\x8"         // 8 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    MOVE "\x6"
-    LINE "\x7"
-    ,                  // end of display list for this glyph
+    { '*', 91, 8, 34.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+      MOVE "\x6"
+      LINE "\x7"
+    },
 
 // glyph '+'
 
-    "+"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    ,                  // end of display list for this glyph
+    { '+', 99, 6, 42.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+    },
 
 // glyph ','
 
-    ","  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x2\x4"
-    ,                  // end of display list for this glyph
+    { ',', 105, 6, 5.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x2\x4"
+    },
 
 // glyph '-'
 
-    "-"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { '-', 111, 4, 32.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph '.'
 
-    "."  "\x3"         // 3 points for this glyph
-    DRAWADOT "\x2"
-    ,                  // end of display list for this glyph
+    { '.', 115, 3, 4.000,
+      DRAWADOT "\x2"
+    },
 
 // glyph '/'
 
-    "/"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { '/', 118, 4, 36.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph '0'
 
-    "0"  "\x5"         // 5 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    ,                  // end of display list for this glyph
+    { '0', 122, 5, 42.000,
+      ELLIPSE "\x2\x3\x4"
+    },
 
 // glyph '1'
 
-    "1"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ,                  // end of display list for this glyph
+    { '1', 127, 5, 16.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+    },
 
 // glyph '2'
 
-    "2"  "\xa"         // 10 points for this glyph
-    ENDFIGURE
-    ELLIPTICARC "\x2\x3\x4\xe0\x40"
-    POLYELLIPTICSPLINE "\x4\x5"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { '2', 132, 10, 38.000,
+      ENDFIGURE
+      ELLIPTICARC "\x2\x3\x4\xe0\x40"
+      POLYELLIPTICSPLINE "\x4\x5"
+      LINE "\x9"
+    },
 
 // glyph '3'
 
-    "3"  "\x11"         // 17 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\xe\x3"
-    ,                  // end of display list for this glyph
+    { '3', 142, 17, 38.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\xe\x3"
+    },
 
 // glyph '4'
 
-    "4"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x3\x3"
-    ,                  // end of display list for this glyph
+    { '4', 159, 6, 40.000,
+      MOVE "\x2"
+      POLYLINE "\x3\x3"
+    },
 
 // glyph '5'
 
-    "5"  "\xd"         // 13 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    POLYELLIPTICSPLINE "\x8\x5"
-    ,                  // end of display list for this glyph
+    { '5', 165, 13, 38.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+      POLYELLIPTICSPLINE "\x8\x5"
+    },
 
 // glyph '6'
 
-    "6"  "\xb"         // 11 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    POLYELLIPTICSPLINE "\x2\x6"
-    ELLIPTICARC "\x8\x9\xa\x0\x2c"
-    ,                  // end of display list for this glyph
+    { '6', 178, 11, 38.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      POLYELLIPTICSPLINE "\x2\x6"
+      ELLIPTICARC "\x8\x9\xa\x0\x2c"
+    },
 
 // glyph '7'
 
-    "7"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x2\x4"
-    ,                  // end of display list for this glyph
+    { '7', 189, 6, 44.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x2\x4"
+    },
 
 // glyph '8'
 
-    "8"  "\x13"         // 19 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x10\x3"
-    CLOSEFIGURE
-    ,                  // end of display list for this glyph
+    { '8', 195, 19, 38.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x10\x3"
+      CLOSEFIGURE
+    },
 
 // glyph '9'
 
-    "9"  "\xb"         // 11 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    POLYELLIPTICSPLINE "\x2\x6"
-    ELLIPTICARC "\x8\x9\xa\x0\x2c"
-    ,                  // end of display list for this glyph
+    { '9', 214, 11, 38.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      POLYELLIPTICSPLINE "\x2\x6"
+      ELLIPTICARC "\x8\x9\xa\x0\x2c"
+    },
 
 // glyph ':'
 
-    ":"  "\x4"         // 4 points for this glyph
-    DRAWADOT "\x2"
-    DRAWADOT "\x3"
-    ,                  // end of display list for this glyph
+    { ':', 225, 4, 4.000,
+      DRAWADOT "\x2"
+      DRAWADOT "\x3"
+    },
 
 // glyph ';'
 
-    ";"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x2\x4"
-    DRAWADOT "\x6"
-    ,                  // end of display list for this glyph
+    { ';', 229, 7, 5.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x2\x4"
+      DRAWADOT "\x6"
+    },
 
 // glyph '<'
 
-    "<"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ,                  // end of display list for this glyph
+    { '<', 236, 5, 38.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+    },
 
 // glyph '='
 
-    "="  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    ,                  // end of display list for this glyph
+    { '=', 241, 6, 35.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+    },
 
 // glyph '>'
 
-    ">"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ,                  // end of display list for this glyph
+    { '>', 247, 5, 38.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+    },
 
 // glyph '?'
 
-    "?"  "\x10"         // 16 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\xc\x3"
-    DRAWADOT "\xf"
-    ,                  // end of display list for this glyph
+    { '?', 252, 16, 35.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\xc\x3"
+      DRAWADOT "\xf"
+    },
 
 // glyph '@"
 
-    "@"  "\x12"         // 18 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    POLYELLIPTICSPLINE "\xc\x6"
-    ,                  // end of display list for this glyph
+    { '@', 268, 18, 68.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      POLYELLIPTICSPLINE "\xc\x6"
+    },
 
 // glyph 'A"
 
-    "A"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ENDFIGURE
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'A', 286, 7, 50.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+      ENDFIGURE
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'B'
 
-    "B"  "\xf"         // 15 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x4\x4"
-    POLYLINE "\x2\x8"
-    POLYELLIPTICSPLINE "\x4\xa"
-    LINE "\xe"
-    CLOSEFIGURE
-    ,                  // end of display list for this glyph
+    { 'B', 293, 15, 37.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x4\x4"
+      POLYLINE "\x2\x8"
+      POLYELLIPTICSPLINE "\x4\xa"
+      LINE "\xe"
+      CLOSEFIGURE
+    },
 
 // glyph 'C'
 
-    "C"  "\x5"         // 5 points for this glyph
-    ENDFIGURE
-    ELLIPTICARC "\x2\x3\x4\xf0\x60"
-    ,                  // end of display list for this glyph
+    { 'C', 308, 5, 47.800,
+      ENDFIGURE
+      ELLIPTICARC "\x2\x3\x4\xf0\x60"
+    },
 
 // glyph 'D'
 
-    "D"  "\x9"         // 9 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x4\x4"
-    LINE "\x8"
-    CLOSEFIGURE
-    ,                  // end of display list for this glyph
+    { 'D', 313, 9, 42.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x4\x4"
+      LINE "\x8"
+      CLOSEFIGURE
+    },
 
 // glyph 'E'
 
-    "E"  "\x8"         // 8 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x3\x3"
-    MOVE "\x6"
-    LINE "\x7"
-    ,                  // end of display list for this glyph
+    { 'E', 322, 8, 34.000,
+      MOVE "\x2"
+      POLYLINE "\x3\x3"
+      MOVE "\x6"
+      LINE "\x7"
+    },
 
 // glyph 'F'
 
-    "F"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'F', 330, 7, 34.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'G'
 
-    "G"  "\x8"         // 8 points for this glyph
-    ENDFIGURE
-    ELLIPTICARC "\x2\x3\x4\xf0\x60"
-    MOVE "\x5"
-    POLYLINE "\x2\6"
-    ,                  // end of display list for this glyph
+    { 'G', 337, 8, 47.800,
+      ENDFIGURE
+      ELLIPTICARC "\x2\x3\x4\xf0\x60"
+      MOVE "\x5"
+      POLYLINE "\x2\6"
+    },
 
 // glyph 'H'
 
-    "H"  "\x8"         // 8 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    MOVE "\x6"
-    LINE "\x7"
-    ,                  // end of display list for this glyph
+    { 'H', 345, 8, 40.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+      MOVE "\x6"
+      LINE "\x7"
+    },
 
 // glyph 'I'
 
-    "I"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { 'I', 353, 4, 4.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph 'J'
 
-    "J"  "\x8"         // 8 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x4\x3"
-    LINE "\x7"
-    ,                  // end of display list for this glyph
+    { 'J', 357, 8, 38.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x4\x3"
+      LINE "\x7"
+    },
 
 // glyph 'K'
 
-    "K"  "\x9"         // 9 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x4\x3"
-    MOVE "\x7"
-    LINE "\x8"
-    ,                  // end of display list for this glyph
+    { 'K', 365, 9, 38.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x4\x3"
+      MOVE "\x7"
+      LINE "\x8"
+    },
 
 // glyph 'L'
 
-    "L"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ,                  // end of display list for this glyph
+    { 'L', 374, 5, 34.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+    },
 
 // glyph 'M'
 
-    "M"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x4\x3"
-    ,                  // end of display list for this glyph
+    { 'M', 379, 7, 64.000,
+      MOVE "\x2"
+      POLYLINE "\x4\x3"
+    },
 
 // glyph 'N'
 
-    "N"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x3\x3"
-    ,                  // end of display list for this glyph
+    { 'N', 386, 6, 40.000,
+      MOVE "\x2"
+      POLYLINE "\x3\x3"
+    },
 
 // glyph 'O'
 
-    "O"  "\x5"         // 5 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    ,                  // end of display list for this glyph
+    { 'O', 392, 5, 56.000,
+      ELLIPSE "\x2\x3\x4"
+    },
 
 // glyph 'P'
 
-    "P"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    POLYELLIPTICSPLINE "\x4\x5"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { 'P', 397, 10, 37.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+      POLYELLIPTICSPLINE "\x4\x5"
+      LINE "\x9"
+    },
 
 // glyph 'Q'
 
-    "Q"  "\x8"         // 8 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    POLYELLIPTICSPLINE "\x2\x6"
-    ,                  // end of display list for this glyph
+    { 'Q', 407, 8, 56.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      POLYELLIPTICSPLINE "\x2\x6"
+    },
 
 // glyph 'R'
 
-    "R"  "\xd"         // 13 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    POLYELLIPTICSPLINE "\x4\x5"
-    LINE "\x9"
-    MOVE "\xa"
-    POLYELLIPTICSPLINE "\x2\xb"
-    ,                  // end of display list for this glyph
+    { 'R', 415, 13, 38.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+      POLYELLIPTICSPLINE "\x4\x5"
+      LINE "\x9"
+      MOVE "\xa"
+      POLYELLIPTICSPLINE "\x2\xb"
+    },
 
 // glyph 'S'
 
-    "S"  "\xf"         // 15 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\xc\x3"
-    ,                  // end of display list for this glyph
+    { 'S', 428, 15, 38.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\xc\x3"
+    },
 
 // glyph 'T'
 
-    "T"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    ,                  // end of display list for this glyph
+    { 'T', 443, 6, 42.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+    },
 
 // glyph 'U'
 
-    "U"  "\x9"         // 9 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x4\x4"
-    LINE "\x8"
-    ,                  // end of display list for this glyph
+    { 'U', 449, 9, 40.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x4\x4"
+      LINE "\x8"
+    },
 
 // glyph 'V'
 
-    "V"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ,                  // end of display list for this glyph
+    { 'V', 458, 5, 44.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+    },
 
 // glyph 'W'
 
-    "W"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x4\x3"
-    ,                  // end of display list for this glyph
+    { 'W', 463, 7, 76.000,
+      MOVE "\x2"
+      POLYLINE "\x4\x3"
+    },
 
 // glyph 'X'
 
-    "X"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    ,                  // end of display list for this glyph
+    { 'X', 470, 6, 44.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+    },
 
 // glyph 'Y'
 
-    "Y"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'Y', 476, 7, 44.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'Z'
 
-    "Z"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x3\x3"
-    ,                  // end of display list for this glyph
+    { 'Z', 483, 6, 40.000,
+      MOVE "\x2"
+      POLYLINE "\x3\x3"
+    },
 
 // glyph '['
 
-    "["  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x3\x3"
-    ,                  // end of display list for this glyph
+    { '[', 489, 6, 14.000,
+      MOVE "\x2"
+      POLYLINE "\x3\x3"
+    },
 
 // glyph '\\'
 
-    "\\"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { '\\', 495, 4, 36.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph ']'
 
-    "]"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x3\x3"
-    ,                  // end of display list for this glyph
+    { ']', 499, 6, 14.000,
+      MOVE "\x2"
+      POLYLINE "\x3\x3"
+    },
 
 // glyph '^'
 
-    "^"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ,                  // end of display list for this glyph
+    { '^', 505, 5, 34.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+    },
 
 // glyph '_'
 
-    "_"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { '_', 510, 4, 42.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph '`'
 
-    "`"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { '`', 514, 4, 11.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph 'a'
 
-    "a"  "\x7"         // 7 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'a', 518, 7, 40.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'b'
 
-    "b"  "\x7"         // 7 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'b', 525, 7, 40.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'c'
 
-    "c"  "\x5"         // 5 points for this glyph
-    ENDFIGURE
-    ELLIPTICARC "\x2\x3\x4\xf0\x60"
-    ,                  // end of display list for this glyph
+    { 'c', 532, 5, 34.200,
+      ENDFIGURE
+      ELLIPTICARC "\x2\x3\x4\xf0\x60"
+    },
 
 // glyph 'd'
 
-    "d"  "\x7"         // 7 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'd', 537, 7, 40.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'e'
 
-    "e"  "\xc"         // 12 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x8\x4"
-    ,                  // end of display list for this glyph
+    { 'e', 544, 12, 40.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x8\x4"
+    },
 
 // glyph 'f'
 
-    "f"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x4\x3"
-    LINE "\x7"
-    MOVE "\x8"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { 'f', 556, 10, 38.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x4\x3"
+      LINE "\x7"
+      MOVE "\x8"
+      LINE "\x9"
+    },
 
 // glyph 'g'
 
-    "g"  "\xb"         // 11 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    LINE "\x6"
-    POLYELLIPTICSPLINE "\x4\x7"
-    ,                  // end of display list for this glyph
+    { 'g', 566, 11, 40.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      LINE "\x6"
+      POLYELLIPTICSPLINE "\x4\x7"
+    },
 
 // glyph 'h'
 
-    "h"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    POLYELLIPTICSPLINE "\x4\x5"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { 'h', 577, 10, 34.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      POLYELLIPTICSPLINE "\x4\x5"
+      LINE "\x9"
+    },
 
 // glyph 'i'
 
-    "i"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    DRAWADOT "\x4"
-    ,                  // end of display list for this glyph
+    { 'i', 587, 5, 4.000,
+      MOVE "\x2"
+      LINE "\x3"
+      DRAWADOT "\x4"
+    },
 
 // glyph 'j'
 
-    "j"  "\x9"         // 9 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x4\x4"
-    DRAWADOT "\x8"
-    ,                  // end of display list for this glyph
+    { 'j', 592, 9, 17.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x4\x4"
+      DRAWADOT "\x8"
+    },
 
 // glyph 'k'
 
-    "k"  "\x8"         // 8 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    MOVE "\x6"
-    LINE "\x7"
-    ,                  // end of display list for this glyph
+    { 'k', 601, 8, 30.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+      MOVE "\x6"
+      LINE "\x7"
+    },
 
 // glyph 'l'
 
-    "l"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { 'l', 609, 4, 4.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph 'm'
 
-    "m"  "\x10"         // 16 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    POLYELLIPTICSPLINE "\x4\x5"
-    LINE "\x9"
-    MOVE "\xa"
-    POLYELLIPTICSPLINE "\x4\xb"
-    LINE "\xf"
-    ,                  // end of display list for this glyph
+    { 'm', 613, 16, 54.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      POLYELLIPTICSPLINE "\x4\x5"
+      LINE "\x9"
+      MOVE "\xa"
+      POLYELLIPTICSPLINE "\x4\xb"
+      LINE "\xf"
+    },
 
 // glyph 'n'
 
-    "n"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    POLYELLIPTICSPLINE "\x4\x5"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { 'n', 629, 10, 34.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      POLYELLIPTICSPLINE "\x4\x5"
+      LINE "\x9"
+    },
 
 // glyph 'o'
 
-    "o"  "\x5"         // 5 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    ,                  // end of display list for this glyph
+    { 'o', 639, 5, 40.000,
+      ELLIPSE "\x2\x3\x4"
+    },
 
 // glyph 'p'
 
-    "p"  "\x7"         // 7 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'p', 644, 7, 40.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'q'
 
-    "q"  "\x7"         // 7 points for this glyph
-    ELLIPSE "\x2\x3\x4"
-    MOVE "\x5"
-    LINE "\x6"
-    ,                  // end of display list for this glyph
+    { 'q', 651, 7, 40.000,
+      ELLIPSE "\x2\x3\x4"
+      MOVE "\x5"
+      LINE "\x6"
+    },
 
 // glyph 'r'
 
-    "r"  "\x9"         // 9 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    POLYELLIPTICSPLINE "\x4\x5"
-    ,                  // end of display list for this glyph
+    { 'r', 658, 9, 34.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      POLYELLIPTICSPLINE "\x4\x5"
+    },
 
 // glyph 's'
 
-    "s"  "\xf"         // 15 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\xc\x3"
-    ,                  // end of display list for this glyph
+    { 's', 667, 15, 34.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\xc\x3"
+    },
 
 // glyph 't'
 
-    "t"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    POLYELLIPTICSPLINE "\x4\x4"
-    MOVE "\x8"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { 't', 682, 10, 30.000,
+      MOVE "\x2"
+      LINE "\x3"
+      POLYELLIPTICSPLINE "\x4\x4"
+      MOVE "\x8"
+      LINE "\x9"
+    },
 
 // glyph 'u'
 
-    "u"  "\xa"         // 10 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    POLYELLIPTICSPLINE "\x4\x5"
-    LINE "\x9"
-    ,                  // end of display list for this glyph
+    { 'u', 692, 10, 34.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      POLYELLIPTICSPLINE "\x4\x5"
+      LINE "\x9"
+    },
 
 // glyph 'v'
 
-    "v"  "\x5"         // 5 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x2\x3"
-    ,                  // end of display list for this glyph
+    { 'v', 702, 5, 38.000,
+      MOVE "\x2"
+      POLYLINE "\x2\x3"
+    },
 
 // glyph 'w'
 
-    "w"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x4\x3"
-    ,                  // end of display list for this glyph
+    { 'w', 707, 7, 54.000,
+      MOVE "\x2"
+      POLYLINE "\x4\x3"
+    },
 
 // glyph 'x'
 
-    "x"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    MOVE "\x4"
-    LINE "\x5"
-    ,                  // end of display list for this glyph
+    { 'x', 714, 6, 32.000,
+      MOVE "\x2"
+      LINE "\x3"
+      MOVE "\x4"
+      LINE "\x5"
+    },
 
 // glyph 'y'
 
-    "y"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    LINE "\x4"
-    MOVE "\x3"
-    LINE "\x5"
-    ,                  // end of display list for this glyph
+    { 'y', 720, 6, 38.000,
+      MOVE "\x2"
+      LINE "\x3"
+      LINE "\x4"
+      MOVE "\x3"
+      LINE "\x5"
+    },
 
 // glyph 'z'
 
-    "z"  "\x6"         // 6 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x3\x3"
-    ,                  // end of display list for this glyph
+    { 'z', 726, 6, 32.000,
+      MOVE "\x2"
+      POLYLINE "\x3\x3"
+    },
 
 // glyph '{'
 
-    "{"  "\xb"         // 11 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x8\x3"
-    ,                  // end of display list for this glyph
+    { '{', 732, 11, 14.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x8\x3"
+    },
 
 // glyph '|'
 
-    "|"  "\x4"         // 4 points for this glyph
-    MOVE "\x2"
-    LINE "\x3"
-    ,                  // end of display list for this glyph
+    { '|', 743, 4, 4.000,
+      MOVE "\x2"
+      LINE "\x3"
+    },
 
 // glyph '}'
 
-    "}"  "\xb"         // 11 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x8\x3"
-    ,                  // end of display list for this glyph
+    { '}', 747, 11, 14.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x8\x3"
+    },
 
 // glyph '~'
 
-    "~"  "\x7"         // 7 points for this glyph
-    MOVE "\x2"
-    POLYELLIPTICSPLINE "\x4\x3"
-    ,                  // end of display list for this glyph
+    { '~', 758, 7, 38.000,
+      MOVE "\x2"
+      POLYELLIPTICSPLINE "\x4\x3"
+    },
 
 // glyph '\x7f' ("house" symbol for unimplemented chars)
 
-    "\x7f"  "\x7"        // 7 points for this glyph
-    MOVE "\x2"
-    POLYLINE "\x4\x3"
-    CLOSEFIGURE
-    ,                  // end of display list for this glyph
-
+    { '\x7f', 765, 7, 44.000,
+      MOVE "\x2"
+      POLYLINE "\x4\x3"
+      CLOSEFIGURE
+    },
 };
 
 //---------------------------------------------------------------------
 //
-// Public functions: The TextApp constructor allocates and initializes
-// the font data structures
+// Returns a pointer to the glyph table entry for character code cc.
+// If the glyph is not implemented, returns the entry for the default
+// symbol.
 //
 //---------------------------------------------------------------------
 
-TextApp::TextApp() : _width(0), _xspace(1.0)
+inline const GLYPH* GetGlyph(int cc)
 {
-    int offset = 0;
-    int oldcc = 0;
+    int index = cc & 0x7f;
 
-    memset(_glyphtbl, 0, sizeof(_glyphtbl));
-    _glyph = new GLYPH[ARRAY_LEN(displaylist)];
-    assert(_glyph != 0);  // out of memory?
-    for (int i = 0; i < ARRAY_LEN(displaylist); ++i)
-    {
-        GLYPH *p = &_glyph[i];
-        char *s = displaylist[i];
-        int cc = s[0];
-
-        assert(oldcc < cc);
-        p->charcode = cc;
-        p->xyindex = offset;
-        p->xylen = s[1];
-        offset += p->xylen;
-        p->displist = &s[2];
-        p->xy = 0;
-        _glyphtbl[cc] = p;
-        oldcc = cc;
-    }
-    assert(offset == ARRAY_LEN(xytbl));
+    if (cc > 0x7f || index < GLYPH_FIRSTCHAR)
+        index = GLYPH_LASTCHAR;
+
+    return &glyphtbl[index - GLYPH_FIRSTCHAR];
+}
+
+//---------------------------------------------------------------------
+//
+// Public functions: TextApp constructor and destructor. The font data
+// is constant, so the constructor has nothing to initialize except
+// the glyph mask cache.
+//
+//---------------------------------------------------------------------
+
+TextApp::TextApp() : _width(0), _xspace(1.0), _maskcount(0),
+                     _textmask(0), _textmasklen(0)
+{
+    memset(_maskhash, 0, sizeof(_maskhash));
 }
 
 TextApp::~TextApp()
 {
-    for (int i = 0; i < ARRAY_LEN(displaylist); ++i)
-    {
-        if (_glyph[i].xy != 0)
-        {
-            delete[] _glyph[i].xy;
-        }
-    }
-    delete[] _glyph;
+    FlushGlyphMasks();
+    delete[] _textmask;
 }
 
 //---------------------------------------------------------------------
@@ -1905,9 +1924,9 @@ TextApp::~TextApp()
 //
 //---------------------------------------------------------------------
 
-void TextApp::DrawGlyph(ShapeGen *sg, char *displist, SGPoint xy[])
+void TextApp::DrawGlyph(ShapeGen *sg, const char *displist, SGPoint xy[])
 {
-    signed char *p = reinterpret_cast<signed char*>(displist);
+    const signed char *p = reinterpret_cast<const signed char*>(displist);
 
     //sg->BeginPath();
     while (p[0] != 0)
@@ -1967,6 +1986,148 @@ void TextApp::DrawGlyph(ShapeGen *sg, char *displist, SGPoint xy[])
     //sg->StrokePath();
 }
 
+//---------------------------------------------------------------------
+//
+// Private function: Transforms the x-y coordinates in xytbl for the
+// glyph pointed to by parameter p, and converts them to 16.16 fixed-
+// point format. Parameter xform is the transformation matrix, and
+// parameter pos is the x-y position at which to draw the glyph. The
+// transformed coordinates are written to the _xy array, which is
+// preallocated to hold the points for the largest glyph. (The glyph's
+// points are copied to the path as soon as the glyph is drawn, so the
+// array can be reused for the next glyph.) Returns a pointer to the
+// transformed coordinates.
+//
+//---------------------------------------------------------------------
+
+SGPoint* TextApp::TransformGlyph(const GLYPH *p, const float xform[], const XY& pos)
+{
+    // Point to start of xytbl entries for this glyph
+    const XY *pxytbl = &xytbl[p->xyindex];
+
+    assert(p->xylen <= GLYPH_MAXPOINTS);
+    for (int j = 2; j < p->xylen; ++j)
+    {
+        float xtbl = pxytbl[j].x;
+        float ytbl = pxytbl[j].y;
+
+        _xy[j].x = 65536*(xform[0]*xtbl - xform[2]*ytbl + pos.x);
+        _xy[j].y = 65536*(xform[1]*xtbl - xform[3]*ytbl + pos.y);
+    }
+    return _xy;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Gets the cached coverage mask for the glyph
+// pointed to by parameter p, stroked with the current stroke width at
+// the specified scale, and with a pen position that is offset by subx
+// quarter pixels to the right of a pixel boundary. If the mask is not
+// already in the cache, the glyph is stroked with an A8 renderer to
+// create a new mask, which is then added to the cache.
+//
+//---------------------------------------------------------------------
+
+GLYPHMASK* TextApp::GetGlyphMask(const GLYPH *p, float scale, int subx)
+{
+    int cc = p->charcode;
+    int index = (GLYPHMASK_SUBPIXELS*cc + subx) % GLYPHMASK_HASHLEN;
+    GLYPHMASK *gm;
+
+    for (gm = _maskhash[index]; gm != 0; gm = gm->next)
+    {
+        if (gm->charcode == cc && gm->subx == subx &&
+            gm->scale == scale && gm->width == _width)
+        {
+            return gm;  // cache hit
+        }
+    }
+
+    // Find the extent of the stroked glyph relative to the pen
+    // position. The y axis in xytbl points up, but points down on
+    // the display. Add a margin for the stroke width and round caps.
+    const XY *pxytbl = &xytbl[p->xyindex];
+    float xmin = pxytbl[0].x, xmax = pxytbl[1].x;
+    float ymin = pxytbl[0].y, ymax = pxytbl[1].y;
+    float margin = _width/2 + 2.0f;
+
+    for (int j = 2; j < p->xylen; ++j)
+    {
+        xmin = min(xmin, pxytbl[j].x);
+        xmax = max(xmax, pxytbl[j].x);
+        ymin = min(ymin, pxytbl[j].y);
+        ymax = max(ymax, pxytbl[j].y);
+    }
+    int x0 = floor(scale*xmin - margin);
+    int y0 = floor(-scale*ymax - margin);
+    int x1 = ceil(scale*xmax + margin + 1.0f);
+    int y1 = ceil(-scale*ymin + margin + 1.0f);
+
+    gm = new GLYPHMASK;
+    assert(gm != 0);  // out of memory?
+    gm->charcode = cc;
+    gm->scale = scale;
+    gm->width = _width;
+    gm->subx = subx;
+    gm->x0 = x0;
+    gm->y0 = y0;
+    gm->w = x1 - x0;
+    gm->h = y1 - y0;
+    gm->mask = new unsigned char[gm->w*gm->h];
+    assert(gm->mask != 0);  // out of memory?
+    memset(gm->mask, 0, gm->w*gm->h);
+
+    // Stroke the glyph into the mask
+    PIXEL_BUFFER pixbuf;
+    pixbuf.pixels = reinterpret_cast<COLOR*>(gm->mask);
+    pixbuf.width = gm->w;
+    pixbuf.height = gm->h;
+    pixbuf.depth = 8;
+    pixbuf.pitch = gm->w;
+    SGRect clip = { 0, 0, gm->w, gm->h };
+    SmartPtr<EnhancedRenderer> rend(CreateAlphaRenderer(&pixbuf));
+    SmartPtr<ShapeGen> sg(CreateShapeGen(&(*rend), clip));
+    float xform[6] = { scale, 0, 0, scale, 0, 0 };
+    XY pos;
+
+    pos.x = float(subx)/GLYPHMASK_SUBPIXELS - x0;
+    pos.y = -y0;
+    sg->SetFixedBits(16);
+    sg->SetLineWidth(_width);
+    sg->SetLineEnd(LINEEND_ROUND);
+    sg->SetLineJoin(LINEJOIN_ROUND);
+    sg->BeginPath();
+    DrawGlyph(&(*sg), p->displist, TransformGlyph(p, xform, pos));
+    sg->StrokePath();
+
+    gm->next = _maskhash[index];
+    _maskhash[index] = gm;
+    ++_maskcount;
+    return gm;
+}
+
+//---------------------------------------------------------------------
+//
+// Private function: Deletes all the glyph masks in the cache
+//
+//---------------------------------------------------------------------
+
+void TextApp::FlushGlyphMasks()
+{
+    for (int i = 0; i < GLYPHMASK_HASHLEN; ++i)
+    {
+        while (_maskhash[i] != 0)
+        {
+            GLYPHMASK *gm = _maskhash[i];
+
+            _maskhash[i] = gm->next;
+            delete[] gm->mask;
+            delete gm;
+        }
+    }
+    _maskcount = 0;
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Draws the glyphs for the specified character
@@ -1989,56 +2150,23 @@ void TextApp::DisplayText(ShapeGen *sg, const float xform[], const char *str)
     int nbits = sg->SetFixedBits(16);
     LINEEND saveLineEnd = sg->SetLineEnd(LINEEND_ROUND);
     LINEJOIN saveLineJoin = sg->SetLineJoin(LINEJOIN_ROUND);
-    int len = strnlen(str, MAXLEN);
-    float lbear = _xspace*leftbearing;
-    float rbear = _xspace*rightbearing;
-    float advance;
-    XY pos;
+    XY xypos[MAXLEN];
+    int len = GetGlyphPositions(xform, str, xypos, MAXLEN);
+
+    assert(str[len] == '\0');  // string too long?
 
     _width = sg->SetLineWidth(0);
     sg->SetLineWidth(_width);
-    assert(len < MAXLEN);
-    pos.x = xform[0]*lbear + xform[4];
-    pos.y = xform[1]*lbear + xform[5];
 
     // Each iteration of this for-loop draws one character
     sg->BeginPath();
     for (int i = 0; i < len; ++i)
     {
-        int cc = str[i];
-        GLYPH *p = _glyphtbl[cc & 0x7f];
-
-        // If glyph is not implemented, use default symbol
-        if (cc > 0x7f || p == 0)
-            p = _glyphtbl[0x7f];
+        const GLYPH *p = GetGlyph(str[i]);
 
-        // Point to start of xytbl entries for this glyph
-        const XY *pxytbl = &xytbl[p->xyindex];
-
-        // Transform the x-y coordinates for this glyph, and convert
-        // them to 16.16 fixed-point format
-        if (p->xy == 0 && p->xylen != 0)
-        {
-            // Allocate buffer for transformed x-y coordinates
-            p->xy = new SGPoint[p->xylen];
-            assert(p->xy != 0);
-        }
-        for (int j = 2; j < p->xylen; ++j)
-        {
-            float xtbl = pxytbl[j].x;
-            float ytbl = pxytbl[j].y;
-
-            p->xy[j].x = 65536*(xform[0]*xtbl - xform[2]*ytbl + pos.x);
-            p->xy[j].y = 65536*(xform[1]*xtbl - xform[3]*ytbl + pos.y);
-        }
-
-        // Interpret display list for this glyph
-        DrawGlyph(sg, p->displist, p->xy);
-
-        // Advance to x-y position of next glyph
-        advance = lbear + (pxytbl[1].x - pxytbl[0].x) + rbear;
-        pos.x += xform[0]*advance;
-        pos.y += xform[1]*advance;
+        // Transform the x-y coordinates for this glyph, and then
+        // interpret the display list for this glyph
+        DrawGlyph(sg, p->displist, TransformGlyph(p, xform, xypos[i]));
     }
     sg->StrokePath();
     sg->SetFixedBits(nbits);  // restore caller's original settings
@@ -2069,6 +2197,189 @@ void TextApp::DisplayText(ShapeGen *sg, SGPoint xystart, float scale, const char
     DisplayText(sg, xform, str);
 }
 
+//---------------------------------------------------------------------
+//
+// Public function: Draws a horizontal text string, like the preceding
+// DisplayText function, but uses cached glyph coverage masks instead
+// of stroking the glyphs every time the text is drawn. Each glyph is
+// stroked into a mask only the first time it is drawn at a particular
+// scale, stroke width, and subpixel x offset. The masks for the glyphs
+// in the string are combined into a single coverage mask, which the
+// aarend renderer uses to paint the string in the specified color.
+// The baseline is snapped to the nearest pixel row, and x positions
+// are rounded to the nearest quarter pixel. Parameter aarend must be
+// the renderer used by the sg ShapeGen object. On return, the
+// renderer is set to do solid color fills in the specified color,
+// and its pattern transform is unchanged. Parameter xystart and the
+// glyph positions are in device pixels, so ShapeGen's path transform
+// is not applied to the text, and it is restored on return. The text
+// is clipped to the current clipping region.
+//
+//---------------------------------------------------------------------
+
+void TextApp::DisplayCachedText(ShapeGen *sg, EnhancedRenderer *aarend, COLOR color,
+                                SGPoint xystart, float scale, const char *str)
+{
+    const int MAXLEN = 256;
+    GLYPHMASK *gmtbl[MAXLEN];
+    SGPoint xypos[MAXLEN];
+    XY xypen[MAXLEN];
+    float xform[6];
+
+    xform[0] = scale;
+    xform[1] = 0;
+    xform[2] = 0;
+    xform[3] = scale;
+    xform[4] = xystart.x;
+    xform[5] = xystart.y;
+    int len = GetGlyphPositions(xform, str, xypen, MAXLEN);
+
+    assert(str[len] == '\0');  // string too long?
+    if (len == 0)
+        return;
+
+    _width = sg->SetLineWidth(0);
+    sg->SetLineWidth(_width);
+    if (_maskcount + len > GLYPHMASK_MAXCOUNT)
+        FlushGlyphMasks();
+
+    // Get the mask for each glyph in the string, and find the
+    // position of each mask relative to the top-left corner of the
+    // string's bounding box
+    int xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+    for (int i = 0; i < len; ++i)
+    {
+        const GLYPH *p = GetGlyph(str[i]);
+        float xpen = xypen[i].x;
+        float xfloor = floor(xpen);
+        int x = xfloor;
+        int subx = GLYPHMASK_SUBPIXELS*(xpen - xfloor) + 0.5f;
+        if (subx == GLYPHMASK_SUBPIXELS)
+        {
+            subx = 0;
+            ++x;
+        }
+        GLYPHMASK *gm = GetGlyphMask(p, scale, subx);
+        gmtbl[i] = gm;
+        xypos[i].x = x + gm->x0;
+        xypos[i].y = xystart.y + gm->y0;
+        if (i == 0)
+        {
+            xmin = xypos[i].x, xmax = xmin + gm->w;
+            ymin = xypos[i].y, ymax = ymin + gm->h;
+        }
+        else
+        {
+            xmin = min(xmin, xypos[i].x);
+            xmax = max(xmax, xypos[i].x + gm->w);
+            ymin = min(ymin, xypos[i].y);
+            ymax = max(ymax, xypos[i].y + gm->h);
+        }
+    }
+
+    // Combine the glyph masks into a single mask for the string
+    int w = xmax - xmin, h = ymax - ymin;
+    if (_textmasklen < w*h)
+    {
+        delete[] _textmask;
+        _textmasklen = w*h;
+        _textmask = new unsigned char[_textmasklen];
+        assert(_textmask != 0);  // out of memory?
+    }
+    memset(_textmask, 0, w*h);
+    for (int i = 0; i < len; ++i)
+    {
+        GLYPHMASK *gm = gmtbl[i];
+        const unsigned char *src = gm->mask;
+        unsigned char *dst = &_textmask[(xypos[i].y - ymin)*w + xypos[i].x - xmin];
+
+        for (int j = 0; j < gm->h; ++j)
+        {
+            for (int k = 0; k < gm->w; ++k)
+            {
+                // Use a src-over blend where glyphs overlap
+                int a = src[k], b = dst[k];
+                dst[k] = a + b - (a*b + 127)/255;
+            }
+            src = &src[gm->w];
+            dst = &dst[w];
+        }
+    }
+
+    // Paint the string through the combined mask. The mask's
+    // bounding box is aligned to the pixel grid, so FillRects passes
+    // it to the renderer as a clipped rectangle, and the renderer
+    // blends the mask values, scaled by the color's alpha, directly
+    // into the pixels within the rectangle.
+    float xfsave[6], pathxf[6];
+    bool bxform = aarend->GetTransform(xfsave);
+    bool bpathxf = sg->GetPathTransform(pathxf);
+    int nbits = sg->SetFixedBits(0);
+    SGRect rect = { xmin, ymin, w, h };
+    sg->SetPathTransform(0);  // mask position is in device pixels
+    aarend->SetTransform(0);
+    aarend->SetColor(color);
+    aarend->SetPattern(reinterpret_cast<COLOR*>(_textmask), xmin, ymin,
+                       w, h, w, FLAG_IMAGE_A8);
+    sg->FillRects(&rect, 1);
+    aarend->SetColor(color);
+    aarend->SetTransform(bxform ? xfsave : 0);  // restore caller's transform
+    sg->SetFixedBits(nbits);  // restore caller's original settings
+    sg->SetPathTransform(bpathxf ? pathxf : 0);
+}
+
+//---------------------------------------------------------------------
+//
+// Public function: Lays out a text string in a single pass. Calculates
+// the x-y position at which each glyph in the string would be drawn
+// if the string were displayed with the specified transform and the
+// current text spacing factor. (Nothing is actually drawn by this
+// function.) Parameter xform is the 6-element affine transformation
+// matrix, and is defined as in the SVG standard. Parameter str is the
+// text string. Parameter xypos is an array of maxcount elements that
+// receives the positions. Element xypos[i] is the position of the
+// glyph's origin (that is, the intersection of its baseline with its
+// left edge, not including the left-side bearing) for character
+// str[i]. The element that follows the position of the last glyph is
+// the end point of the string, as calculated by GetTextEndpoint. The
+// return value is the number of glyph positions written to xypos,
+// which is less than the string length if the array is too small.
+// Each glyph's advance is read from the glyph table, so the positions
+// of all the glyphs in a string are calculated without reading any
+// glyph coordinates.
+//
+//---------------------------------------------------------------------
+
+int TextApp::GetGlyphPositions(const float xform[], const char *str,
+                               XY xypos[], int maxcount)
+{
+    float lbear = _xspace*leftbearing;
+    float rbear = _xspace*rightbearing;
+    float advance;
+    XY pos;
+    int i;
+
+    assert(xypos != 0 && maxcount > 0);
+    pos.x = xform[0]*lbear + xform[4];
+    pos.y = xform[1]*lbear + xform[5];
+    for (i = 0; i < maxcount - 1 && str[i] != '\0'; ++i)
+    {
+        const GLYPH *p = GetGlyph(str[i]);
+
+        xypos[i] = pos;
+
+        // Advance to x-y position of next glyph
+        advance = lbear + p->advance + rbear;
+        pos.x += xform[0]*advance;
+        pos.y += xform[1]*advance;
+    }
+
+    // Back up from origin of next glyph to end of last glyph
+    xypos[i].x = pos.x - xform[0]*lbear;
+    xypos[i].y = pos.y - xform[1]*lbear;
+    return i;
+}
+
 //---------------------------------------------------------------------
 //
 // Public function: Calculates what the x-y coordinates would be at
@@ -2096,17 +2407,9 @@ void TextApp::GetTextEndpoint(const float xform[], const char *str, XY *xyout)
     for (int i = 0; i < len; ++i)
     {
         int cc = str[i];
-        GLYPH *p = _glyphtbl[cc & 0x7f];
-
-        // If glyph is not implemented, use default symbol
-        if (cc > 0x7f || p == 0)
-            p = _glyphtbl[0x7f];
-
-        // Point to the start of the xytbl entries for this glyph
-        const XY *pxytbl = &xytbl[p->xyindex];
+        const GLYPH *p = GetGlyph(cc);
 
-        // First two entries are bounding box min/max coordinates
-        advance += pxytbl[1].x - pxytbl[0].x;
+        advance += p->advance;
     }
 
     // Advance to x-y position at end of last glyph